@@ -4,11 +4,22 @@
 
  %template(FloatVector) std::vector<float>;
 
- %module gipf
+ /* Wrapped calls release the GIL, so PUCTMCTS can ponder on a background
+    thread that calls back into Python evaluators. */
+ %module(directors="1", threads="1") gipf
  %{
  /* Includes the header in the wrapper code */
  #include "gtsa.hpp"
  #include "gipf.h"
+ #include "game_record.h"
+ #include "search_stats.h"
+ #include "parallel_mcts.h"
+ #include "transposition_table.h"
+ #include "puct_mcts.h"
+ #include "alpha_beta.h"
+ #include "feature_planes.h"
+ #include "symmetry.h"
+ #include "batch_goodness.h"
  %}
  
  /* Parse the header file to generate wrappers */
@@ -18,7 +29,69 @@
  %template(BaseGipfMove) Move<GipfMove>;
  %template(BaseGipfState) State<GipfState, GipfMove>;
 
+ %ignore enumerate_capture_sets;
+ %ignore read_position;
+ %ignore write_position;
+ %include "board.h"
  %include "gipf.h"
+ %include "game_record.h"
+
+/* Only the statistics and the log; recording is internal to the searches. */
+ %ignore active_search_stats;
+ %ignore active_phase_clock;
+ %ignore PhaseClock;
+ %ignore PhaseScope;
+ %ignore switch_cost_ticks;
+ %ignore SearchStatsScope;
+ %ignore stats_node;
+ %ignore stats_expansion;
+ %ignore stats_probe;
+ %ignore SearchStats::record_node;
+ %ignore SearchStats::record_expansion;
+ %ignore SearchStats::record_probe;
+ %exception SearchStatsLog::SearchStatsLog {
+	try {
+		$action
+	} catch (const std::exception &error) {
+		PyErr_SetString(PyExc_RuntimeError, error.what());
+		SWIG_fail;
+	}
+ }
+ %include "search_phase.h"
+ %include "search_stats.h"
+
+/* PUCTEvaluator can be subclassed in Python to supply priors and values.
+   A Python exception in a callback aborts the search and is re-raised. */
+ %feature("director") PUCTEvaluator;
+ %feature("director:except") {
+	if ($error != NULL)
+		throw Swig::DirectorMethodException();
+ }
+ %exception PUCTMCTS::get_move {
+	try {
+		$action
+	} catch (Swig::DirectorException &error) {
+		/* An error from pondering was raised on the ponder thread, whose
+		   Python error state is gone by now. */
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_RuntimeError, error.getMessage());
+		SWIG_fail;
+	} catch (const std::exception &error) {
+		PyErr_SetString(PyExc_RuntimeError, error.what());
+		SWIG_fail;
+	}
+ }
+ %template(GipfAlgorithm) Algorithm<GipfState, GipfMove>;
+ %include "parallel_mcts.h"
+ %include "transposition_table.h"
+ %include "puct_mcts.h"
+ %ignore AlphaBetaShared;
+ %ignore AlphaBetaWorker;
+ %include "alpha_beta.h"
+ %include "feature_planes.h"
+ %ignore SymmetryTables;
+ %ignore symmetry;
+ %include "symmetry.h"
 
 %extend GipfState {
 	std::string __str__() {
@@ -27,3 +100,163 @@
 		return os.str();
 	}
 }
+
+/* Zero-copy views of a mapped record file, for numpy.frombuffer. They are
+   only valid while the reader is alive. */
+%nothread GameRecordReader::buffer;
+%nothread GameRecordReader::index_buffer;
+%extend GameRecordReader {
+	PyObject *buffer() {
+		return PyMemoryView_FromMemory(const_cast<char *>($self->data()),
+		                               $self->size(), PyBUF_READ);
+	}
+
+	PyObject *index_buffer() {
+		const vector<uint64_t> &offsets = $self->index();
+		return PyMemoryView_FromMemory(
+		    reinterpret_cast<char *>(const_cast<uint64_t *>(offsets.data())),
+		    offsets.size() * sizeof(uint64_t), PyBUF_READ);
+	}
+}
+
+/* Feature export into caller-owned buffers such as numpy arrays, with no
+   intermediate copies. `states` is a sequence of GipfState and `out` a
+   writable C-contiguous buffer of float32 or uint8 holding exactly
+   len(states) * FEATURE_SIZE (or PUSH_COUNT) items. */
+%{
+/* Points `states` at the GipfStates in `sequence`. Returns the list or
+   tuple holding them, which keeps states made by a generator alive: the
+   caller releases it only once done with the pointers. */
+static PyObject *unwrap_states(PyObject *sequence,
+                               vector<const GipfState *> &states) {
+	PyObject *items = PySequence_Fast(sequence, "states must be a sequence");
+	if (!items)
+		return nullptr;
+	const Py_ssize_t n = PySequence_Fast_GET_SIZE(items);
+	states.resize(n);
+	for (Py_ssize_t i = 0; i < n; i++) {
+		void *state = nullptr;
+		if (!SWIG_IsOK(SWIG_ConvertPtr(PySequence_Fast_GET_ITEM(items, i),
+		                               &state, SWIGTYPE_p_GipfState, 0))) {
+			Py_DECREF(items);
+			PyErr_SetString(PyExc_TypeError, "states must be GipfState");
+			return nullptr;
+		}
+		states[i] = static_cast<const GipfState *>(state);
+	}
+	return items;
+}
+
+template <class Encode>
+static PyObject *encode_into(PyObject *sequence, PyObject *out,
+                             size_t per_state, Encode encode) {
+	vector<const GipfState *> states;
+	PyObject *held = unwrap_states(sequence, states);
+	if (!held)
+		return nullptr;
+	Py_buffer view;
+	if (PyObject_GetBuffer(out, &view,
+	                       PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS |
+	                           PyBUF_FORMAT) != 0) {
+		Py_DECREF(held);
+		return nullptr;
+	}
+
+	PyObject *result = nullptr;
+	const string format = view.format ? view.format : "B";
+	const bool is_float = format == "f" || format == "<f" || format == "=f";
+	const bool is_byte = format == "B" || format == "<B" || format == "=B";
+	const size_t items = states.size() * per_state;
+	if (!is_float && !is_byte) {
+		PyErr_SetString(PyExc_TypeError, "out must hold float32 or uint8");
+	} else if ((size_t)view.len != items * view.itemsize) {
+		PyErr_Format(PyExc_ValueError, "out must hold %zu items", items);
+	} else {
+		Py_BEGIN_ALLOW_THREADS
+		if (is_float)
+			encode(states.data(), states.size(),
+			       static_cast<float *>(view.buf));
+		else
+			encode(states.data(), states.size(),
+			       static_cast<uint8_t *>(view.buf));
+		Py_END_ALLOW_THREADS
+		Py_INCREF(Py_None);
+		result = Py_None;
+	}
+	PyBuffer_Release(&view);
+	Py_DECREF(held);
+	return result;
+}
+
+struct PlaneEncoder {
+	template <class T>
+	void operator()(const GipfState *const *states, size_t n, T *out) const {
+		encode_planes(states, n, out);
+	}
+};
+
+struct PushEncoder {
+	template <class T>
+	void operator()(const GipfState *const *states, size_t n, T *out) const {
+		encode_legal_pushes(states, n, out);
+	}
+};
+%}
+
+%nothread encode_planes_into;
+%nothread encode_legal_pushes_into;
+%inline %{
+PyObject *encode_planes_into(PyObject *states, PyObject *out) {
+	return encode_into(states, out, FEATURE_SIZE, PlaneEncoder());
+}
+
+PyObject *encode_legal_pushes_into(PyObject *states, PyObject *out) {
+	return encode_into(states, out, PUSH_COUNT, PushEncoder());
+}
+%}
+
+/* get_goodness of every state, scored by the batch kernels into a writable
+   C-contiguous int32 buffer of len(states) items. */
+%nothread goodness_into;
+%inline %{
+PyObject *goodness_into(PyObject *sequence, PyObject *out) {
+	vector<const GipfState *> states;
+	PyObject *held = unwrap_states(sequence, states);
+	if (!held)
+		return nullptr;
+	Py_buffer view;
+	if (PyObject_GetBuffer(out, &view,
+	                       PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS |
+	                           PyBUF_FORMAT) != 0) {
+		Py_DECREF(held);
+		return nullptr;
+	}
+
+	PyObject *result = nullptr;
+	const string format = view.format ? view.format : "B";
+	if (format != "i" && format != "<i" && format != "=i") {
+		PyErr_SetString(PyExc_TypeError, "out must hold int32");
+	} else if ((size_t)view.len != states.size() * sizeof(int)) {
+		PyErr_Format(PyExc_ValueError, "out must hold %zu items",
+		             states.size());
+	} else {
+		// Only touching Python objects needs the GIL: unwrapping the
+		// sequence and the buffer protocol above, and releasing both below.
+		// `held` keeps the states alive and `view` the buffer exported
+		// while the batch is gathered and scored without it. The batch is
+		// reserved first so that nothing between the macros can throw.
+		PositionBatch batch;
+		batch.reserve(states.size());
+		Py_BEGIN_ALLOW_THREADS
+		for (auto state : states)
+			batch.push_back(*state);
+		batch_goodness(batch, static_cast<int *>(view.buf));
+		Py_END_ALLOW_THREADS
+		Py_INCREF(Py_None);
+		result = Py_None;
+	}
+	PyBuffer_Release(&view);
+	Py_DECREF(held);
+	return result;
+}
+%}
@@ -0,0 +1,501 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "game_record.h"
+#include "gipf.h"
+#include "search_stats.h"
+#include "transposition_table.h"
+
+/**
+  Iterative-deepening principal variation search for Gipf.
+
+  Negamax over the incremental static evaluation (GipfState::get_goodness),
+  with
+   - aspiration windows around the previous iteration's score,
+   - a transposition table for cutoffs and the first move to try,
+   - move ordering: table move, captures by pieces taken, two killers per
+     ply, then history scores per entry push,
+   - a quiescence search that keeps playing capturing moves at the horizon,
+     so the static evaluation is never taken with a capture pending, and
+   - time management from a per-move budget, checked every 1024 nodes.
+     Only completed iterations choose the move.
+
+  With more than one thread the search is Lazy SMP. Helper threads run
+  their own iterative deepening on the same root and share only the
+  transposition table. Odd helpers start one ply deeper so the threads
+  spread over depths. Their table entries speed up and reorder the main
+  thread's search. The main thread alone picks the move and stops the
+  helpers when it is done.
+*/
+
+const int AB_WIN = 1000000;
+// Scores beyond this are wins or losses found by the search.
+const int AB_WIN_BOUND = AB_WIN - 1000;
+const int AB_MAX_PLY = 128;
+
+struct AlphaBetaStats {
+	// Deepest completed iteration.
+	int depth = 0;
+	long long nodes = 0;
+	long long quiescence_nodes = 0;
+	double seconds = 0;
+	int score = 0;
+	int threads = 1;
+
+	double nodes_per_second() const {
+		return seconds > 0 ? (nodes + quiescence_nodes) / seconds : 0;
+	}
+};
+
+// Search state shared by every thread working on one root position.
+struct AlphaBetaShared {
+	TranspositionTable *table = nullptr;
+	std::atomic<bool> stop{false};
+	std::chrono::steady_clock::time_point deadline;
+};
+
+// One thread's search: its heuristics, counters and recursive search.
+class AlphaBetaWorker {
+  public:
+	long long nodes = 0;
+	long long quiescence_nodes = 0;
+	int max_quiescence_plies = 8;
+	// Filled while this worker searches, in instrumented builds.
+	SearchStats stats;
+
+	explicit AlphaBetaWorker(AlphaBetaShared &shared)
+	    : shared(shared), plies(AB_MAX_PLY) {
+		clear_heuristics();
+	}
+
+	void clear_heuristics() {
+		for (auto &slots : killers)
+			slots[0] = slots[1] = GipfMove(0, direction::N);
+		memset(history, 0, sizeof(history));
+	}
+
+	// Searches `state` to `depth` with aspiration around `guess`. Returns
+	// false if stopped before finishing, leaving `best` and `score` as they
+	// were.
+	bool search_root(GipfState &state, int depth, int guess, GipfMove &best,
+	                 int &score) {
+		int window = depth > 1 ? 25 : AB_WIN;
+		int alpha = std::max(guess - window, -AB_WIN);
+		int beta = std::min(guess + window, AB_WIN);
+		while (true) {
+			const int value = search(state, depth, alpha, beta, 0, true);
+			if (stopped())
+				return false;
+			if (value <= alpha && alpha > -AB_WIN) {
+				window *= 4;
+				alpha = std::max(value - window, -AB_WIN);
+			} else if (value >= beta && beta < AB_WIN) {
+				window *= 4;
+				beta = std::min(value + window, AB_WIN);
+			} else {
+				best = root_best;
+				score = value;
+				return true;
+			}
+		}
+	}
+
+  private:
+	AlphaBetaShared &shared;
+	GipfMove root_best;
+	GipfMove killers[AB_MAX_PLY][2];
+	// Cutoff credit per entry push and side to move.
+	int history[42][2];
+
+	// The moves of the node being searched at each ply and their ordering.
+	// Kept across nodes, so the search stack holds no move lists and stops
+	// allocating once every ply has seen its largest position.
+	struct PlyMoves {
+		GipfMoveList moves;
+		std::vector<int> scores;
+		std::vector<int> order;
+	};
+	std::vector<PlyMoves> plies;
+
+	bool stopped() const {
+		return shared.stop.load(std::memory_order_relaxed);
+	}
+
+	void poll_clock() {
+		if (((nodes + quiescence_nodes) & 1023) == 0 &&
+		    std::chrono::steady_clock::now() >= shared.deadline) {
+			shared.stop.store(true, std::memory_order_relaxed);
+		}
+	}
+
+	bool probe(const GipfState &state, TTEntry &entry) const {
+		if (!shared.table)
+			return false;
+		const bool hit = shared.table->probe(state.key, entry);
+		GIPF_STATS(stats_probe(hit));
+		return hit;
+	}
+
+	static int evaluate(const GipfState &state) {
+		GIPF_PHASE(PHASE_EVAL);
+		return state.get_goodness();
+	}
+
+	static int side(const GipfState &state) {
+		return state.player_to_move == PLAYER_1 ? 0 : 1;
+	}
+
+	// Score of a finished game for the player to move, preferring quick
+	// wins and slow losses.
+	static int terminal_score(const GipfState &state, int ply) {
+		if (state.is_winner(state.player_to_move))
+			return AB_WIN - ply;
+		if (state.is_winner(state.get_enemy(state.player_to_move)))
+			return -(AB_WIN - ply);
+		return 0;
+	}
+
+	// Win scores are stored relative to the node, not the root.
+	static int to_table(int score, int ply) {
+		if (score > AB_WIN_BOUND)
+			return score + ply;
+		if (score < -AB_WIN_BOUND)
+			return score - ply;
+		return score;
+	}
+
+	static int from_table(int score, int ply) {
+		if (score > AB_WIN_BOUND)
+			return score - ply;
+		if (score < -AB_WIN_BOUND)
+			return score + ply;
+		return score;
+	}
+
+	// Pieces of the side not to move that `move` removes from the board.
+	static int captured(const GipfState &state, const GipfMove &move) {
+		const Board &enemy =
+		    state.player_to_move == PLAYER_1 ? state.board_2 : state.board_1;
+		int64_t rows = 0;
+		for (auto row : move.captures)
+			rows |= row;
+		return __builtin_popcountll(rows & enemy.board);
+	}
+
+	void order_moves(const GipfState &state, const GipfMoveList &moves,
+	                 std::vector<int> &scores, int ply,
+	                 const GipfMove *table_move) const {
+		for (int i = 0; i < moves.size(); i++) {
+			const GipfMove &move = moves[i];
+			if (table_move && move == *table_move) {
+				scores[i] = 1 << 30;
+			} else if (!move.captures.empty()) {
+				scores[i] = (1 << 24) + 256 * captured(state, move) +
+				            move.captures.size();
+			} else if (move == killers[ply][0]) {
+				scores[i] = (1 << 23) + 1;
+			} else if (move == killers[ply][1]) {
+				scores[i] = 1 << 23;
+			} else {
+				scores[i] =
+				    history[push_index(move.elt, move.dir)][side(state)];
+			}
+		}
+	}
+
+	// Selection sort step: returns the index of the best-scored move among
+	// order[i..n) after swapping it into order[i].
+	static int pick_move(std::vector<int> &order,
+	                     const std::vector<int> &scores, int i, int n) {
+		int best = i;
+		for (int j = i + 1; j < n; j++) {
+			if (scores[order[j]] > scores[order[best]])
+				best = j;
+		}
+		std::swap(order[i], order[best]);
+		return order[i];
+	}
+
+	void reward(const GipfState &state, const GipfMove &move, int depth,
+	            int ply) {
+		if (!move.captures.empty())
+			return;
+		if (!(move == killers[ply][0])) {
+			killers[ply][1] = killers[ply][0];
+			killers[ply][0] = move;
+		}
+		int &score = history[push_index(move.elt, move.dir)][side(state)];
+		score += depth * depth;
+		if (score > (1 << 22)) {
+			for (auto &row : history) {
+				row[0] /= 2;
+				row[1] /= 2;
+			}
+		}
+	}
+
+	int search(GipfState &state, int depth, int alpha, int beta, int ply,
+	           bool pv) {
+		if (state.is_terminal())
+			return terminal_score(state, ply);
+		if (depth <= 0 || ply >= AB_MAX_PLY - 1)
+			return quiescence(state, alpha, beta, ply, 0);
+
+		nodes++;
+		GIPF_STATS(stats_node(ply));
+		poll_clock();
+		if (stopped())
+			return 0;
+
+		const int original_alpha = alpha;
+		TTEntry entry;
+		GipfMove table_move;
+		bool has_table_move = false;
+		if (probe(state, entry)) {
+			const int value = from_table(entry.value, ply);
+			if (!pv && ply > 0 && entry.depth >= depth &&
+			    (entry.bound == TT_EXACT ||
+			     (entry.bound == TT_LOWER && value >= beta) ||
+			     (entry.bound == TT_UPPER && value <= alpha))) {
+				return value;
+			}
+			if (entry.has_move()) {
+				try {
+					table_move = unpack_move(state, entry.move);
+					has_table_move = true;
+				} catch (const std::exception &) {
+					// A key collision left a move from another position.
+				}
+			}
+		}
+
+		// Quiescence takes over before the last ply, so plies[ply] is free.
+		PlyMoves &node = plies[ply];
+		GipfMoveList &moves = node.moves;
+		moves.clear();
+		state.generate_moves(moves);
+		if (moves.empty())
+			return -(AB_WIN - ply);
+		GIPF_STATS(stats_expansion(moves.size()));
+		std::vector<int> &scores = node.scores, &order = node.order;
+		scores.resize(moves.size());
+		order.resize(moves.size());
+		order_moves(state, moves, scores, ply,
+		            has_table_move ? &table_move : nullptr);
+		for (int i = 0; i < moves.size(); i++)
+			order[i] = i;
+
+		int best_score = -AB_WIN;
+		int best_index = 0;
+		for (int i = 0; i < moves.size(); i++) {
+			const GipfMove &move = moves[pick_move(order, scores, i,
+			                                       moves.size())];
+			state.make_move(move);
+			int value;
+			if (i == 0) {
+				value = -search(state, depth - 1, -beta, -alpha, ply + 1, pv);
+			} else {
+				value = -search(state, depth - 1, -alpha - 1, -alpha, ply + 1,
+				                false);
+				if (value > alpha && value < beta)
+					value =
+					    -search(state, depth - 1, -beta, -alpha, ply + 1, pv);
+			}
+			state.undo_move(move);
+			if (stopped())
+				return 0;
+
+			if (value > best_score) {
+				best_score = value;
+				best_index = order[i];
+				if (ply == 0)
+					root_best = move;
+			}
+			if (value > alpha)
+				alpha = value;
+			if (alpha >= beta) {
+				reward(state, move, depth, ply);
+				break;
+			}
+		}
+
+		if (shared.table) {
+			TTEntry stored;
+			stored.value = to_table(best_score, ply);
+			stored.depth = depth;
+			stored.bound = best_score >= beta
+			                   ? TT_LOWER
+			                   : best_score > original_alpha ? TT_EXACT
+			                                                 : TT_UPPER;
+			stored.move = pack_move(state, moves[best_index]);
+			shared.table->store(state.key, stored);
+		}
+		return best_score;
+	}
+
+	// Searches capturing moves only, standing pat on the static evaluation.
+	int quiescence(GipfState &state, int alpha, int beta, int ply,
+	               int qply) {
+		quiescence_nodes++;
+		GIPF_STATS(stats_node(ply));
+		if (state.is_terminal())
+			return terminal_score(state, ply);
+
+		const int stand_pat = evaluate(state);
+		if (stand_pat >= beta || qply >= max_quiescence_plies ||
+		    ply >= AB_MAX_PLY - 1)
+			return stand_pat;
+		alpha = std::max(alpha, stand_pat);
+
+		poll_clock();
+		if (stopped())
+			return 0;
+
+		// search at this ply handed over before generating its moves.
+		PlyMoves &node = plies[ply];
+		GipfMoveList &moves = node.moves;
+		moves.clear();
+		state.generate_moves(moves);
+		std::vector<int> &scores = node.scores, &order = node.order;
+		scores.resize(moves.size());
+		order.resize(moves.size());
+		int n_captures = 0;
+		for (int i = 0; i < moves.size(); i++) {
+			if (!moves[i].captures.empty()) {
+				scores[i] = captured(state, moves[i]);
+				order[n_captures++] = i;
+			}
+		}
+
+		int best_score = stand_pat;
+		for (int i = 0; i < n_captures; i++) {
+			const GipfMove &move =
+			    moves[pick_move(order, scores, i, n_captures)];
+			state.make_move(move);
+			const int value =
+			    -quiescence(state, -beta, -alpha, ply + 1, qply + 1);
+			state.undo_move(move);
+			if (stopped())
+				return 0;
+
+			best_score = std::max(best_score, value);
+			alpha = std::max(alpha, value);
+			if (alpha >= beta)
+				break;
+		}
+		return best_score;
+	}
+};
+
+struct AlphaBeta : public Algorithm<GipfState, GipfMove> {
+	const double max_seconds;
+	const int max_depth;
+	const int threads;
+
+	AlphaBetaStats last_search;
+	// Statistics of the last search, filled in builds with GIPF_INSTRUMENT.
+	SearchStats last_stats;
+
+	AlphaBeta(double max_seconds = 1, int max_depth = 64,
+	          size_t table_megabytes = 16, int threads = 1)
+	    : max_seconds(max_seconds), max_depth(std::min(max_depth, 64)),
+	      threads(std::max(threads, 1)), table(table_megabytes) {}
+
+	// `log` is not owned; null stops logging.
+	void set_stats_log(SearchStatsLog *log) { stats_log = log; }
+
+	GipfMove get_move(GipfState *state) override {
+		const auto start = std::chrono::steady_clock::now();
+		GipfState root = state->clone();
+		GipfMoveList moves;
+		if (!root.is_terminal())
+			root.generate_moves(moves);
+		if (moves.empty())
+			throw runtime_error("No legal moves to search");
+
+		shared.table = &table;
+		shared.stop = false;
+		shared.deadline =
+		    start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+		                std::chrono::duration<double>(max_seconds));
+		table.new_search();
+
+		vector<std::unique_ptr<AlphaBetaWorker>> workers;
+		for (int i = 0; i < threads; i++)
+			workers.emplace_back(new AlphaBetaWorker(shared));
+		std::vector<std::thread> helpers;
+		for (int i = 1; i < threads; i++) {
+			helpers.emplace_back(&AlphaBeta::help, this, std::ref(*workers[i]),
+			                     state->clone(), 1 + i % 2);
+		}
+
+		GipfMove best = moves[0];
+		int score = 0;
+		last_search = AlphaBetaStats();
+		{
+			GIPF_STATS_SCOPE(workers[0]->stats);
+			for (int depth = 1; depth <= max_depth; depth++) {
+				if (!workers[0]->search_root(root, depth, score, best, score))
+					break;
+				last_search.depth = depth;
+				last_search.score = score;
+				if (std::abs(score) > AB_WIN_BOUND ||
+				    std::chrono::steady_clock::now() >= shared.deadline)
+					break;
+			}
+		}
+		shared.stop = true;
+		for (auto &helper : helpers)
+			helper.join();
+
+		for (const auto &worker : workers) {
+			last_search.nodes += worker->nodes;
+			last_search.quiescence_nodes += worker->quiescence_nodes;
+		}
+		last_search.threads = threads;
+		last_search.seconds = std::chrono::duration<double>(
+		                          std::chrono::steady_clock::now() - start)
+		                          .count();
+
+#ifdef GIPF_INSTRUMENT
+		last_stats = SearchStats();
+		last_stats.algorithm = get_name();
+		last_stats.move = searches;
+		last_stats.threads = threads;
+		last_stats.seconds = last_search.seconds;
+		last_stats.depth = last_search.depth;
+		for (const auto &worker : workers)
+			last_stats.merge(worker->stats);
+		if (stats_log)
+			stats_log->write(last_stats);
+#endif
+		searches++;
+		return best;
+	}
+
+	string get_name() const override { return "AlphaBeta"; }
+
+  private:
+	TranspositionTable table;
+	AlphaBetaShared shared;
+	SearchStatsLog *stats_log = nullptr;
+	int searches = 0;
+
+	// A Lazy SMP helper: deepens from `first_depth` until stopped or past
+	// max_depth. Its results reach the main thread through the table only.
+	void help(AlphaBetaWorker &worker, GipfState root, int first_depth) {
+		GIPF_STATS_SCOPE(worker.stats);
+		GipfMove best;
+		int score = 0;
+		for (int depth = first_depth;
+		     depth <= max_depth && worker.search_root(root, depth, score, best,
+		                                              score);
+		     depth++) {
+		}
+	}
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "gipf.h"
+#include "puct_mcts.h"
+
+/**
+  Batched leaf evaluation.
+
+  Searches running on many threads, typically one per concurrent game, hand
+  their leaves to a shared EvalQueue and block. A dispatcher thread gathers
+  pending leaves into batches of up to `batch_size`, or fewer once the
+  oldest one has waited `timeout`. It passes each batch to a single
+  BatchEvaluator call and wakes the searches when their results are filled
+  in. This keeps a model inference backend at efficient batch sizes.
+*/
+
+struct LeafEvaluation {
+	// One prior per legal move, in the order of the request's moves.
+	vector<float> priors;
+	// Value for the player to move, in [-1, 1].
+	float value = 0;
+};
+
+struct LeafRequest {
+	const GipfState *state;
+	const vector<GipfMove> *moves;
+	LeafEvaluation result;
+};
+
+struct BatchEvaluator {
+	virtual ~BatchEvaluator() {}
+
+	// Fills in `result` for every request. Called from the dispatcher
+	// thread only.
+	virtual void evaluate(const vector<LeafRequest *> &batch) = 0;
+};
+
+// Stands in for a network: uniform priors, a value squashed from the
+// static evaluation, and an optional fixed cost per batch to model
+// inference latency.
+struct StubBatchEvaluator : public BatchEvaluator {
+	double value_scale;
+	std::chrono::microseconds latency;
+
+	StubBatchEvaluator(double value_scale = 200, int latency_us = 0)
+	    : value_scale(value_scale), latency(latency_us) {}
+
+	void evaluate(const vector<LeafRequest *> &batch) override {
+		if (latency.count() > 0)
+			std::this_thread::sleep_for(latency);
+		for (auto *request : batch) {
+			const size_t n = request->moves->size();
+			request->result.priors.assign(n, n ? 1.0f / n : 0);
+			request->result.value =
+			    std::tanh(request->state->get_goodness() / value_scale);
+		}
+	}
+};
+
+struct EvalQueueStats {
+	long long leaves = 0;
+	long long batches = 0;
+	// Batches sent because the oldest leaf timed out rather than full.
+	long long timeouts = 0;
+
+	double average_batch() const {
+		return batches > 0 ? double(leaves) / batches : 0;
+	}
+};
+
+class EvalQueue {
+  public:
+	EvalQueue(BatchEvaluator &evaluator, int batch_size = 64,
+	          double timeout_ms = 2)
+	    : evaluator(evaluator), batch_size(std::max(batch_size, 1)),
+	      timeout(std::chrono::duration_cast<std::chrono::nanoseconds>(
+	          std::chrono::duration<double, std::milli>(timeout_ms))),
+	      dispatcher(&EvalQueue::run, this) {}
+
+	EvalQueue(const EvalQueue &) = delete;
+	EvalQueue &operator=(const EvalQueue &) = delete;
+
+	~EvalQueue() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		work.notify_one();
+		dispatcher.join();
+	}
+
+	// Queues a leaf and blocks until its batch has been evaluated. Rethrows
+	// anything the evaluator threw for that batch.
+	LeafEvaluation evaluate(const GipfState &state,
+	                        const vector<GipfMove> &moves) {
+		Pending pending;
+		pending.request.state = &state;
+		pending.request.moves = &moves;
+		pending.arrived = std::chrono::steady_clock::now();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		queue.push_back(&pending);
+		if (queue.size() == 1 || (int)queue.size() >= batch_size)
+			work.notify_one();
+		finished.wait(lock, [&] { return pending.done; });
+		if (pending.error)
+			std::rethrow_exception(pending.error);
+		return std::move(pending.request.result);
+	}
+
+	EvalQueueStats stats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return counters;
+	}
+
+  private:
+	struct Pending {
+		LeafRequest request;
+		std::chrono::steady_clock::time_point arrived;
+		bool done = false;
+		std::exception_ptr error;
+	};
+
+	BatchEvaluator &evaluator;
+	const int batch_size;
+	const std::chrono::nanoseconds timeout;
+
+	mutable std::mutex mutex;
+	std::condition_variable work, finished;
+	std::deque<Pending *> queue;
+	bool stopping = false;
+	EvalQueueStats counters;
+	// Declared last so that it starts after everything above.
+	std::thread dispatcher;
+
+	void run() {
+		vector<Pending *> batch;
+		vector<LeafRequest *> requests;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			work.wait(lock, [&] { return stopping || !queue.empty(); });
+			if (queue.empty())
+				return;
+			const auto deadline = queue.front()->arrived + timeout;
+			const bool full = work.wait_until(lock, deadline, [&] {
+				return stopping || (int)queue.size() >= batch_size;
+			});
+
+			batch.clear();
+			requests.clear();
+			while (!queue.empty() && (int)batch.size() < batch_size) {
+				batch.push_back(queue.front());
+				requests.push_back(&queue.front()->request);
+				queue.pop_front();
+			}
+			counters.leaves += batch.size();
+			counters.batches++;
+			counters.timeouts += !full;
+
+			lock.unlock();
+			std::exception_ptr error;
+			try {
+				evaluator.evaluate(requests);
+			} catch (...) {
+				error = std::current_exception();
+			}
+			lock.lock();
+			for (auto *pending : batch) {
+				pending->error = error;
+				pending->done = true;
+			}
+			finished.notify_all();
+		}
+	}
+};
+
+// Adapts an EvalQueue to the PUCTEvaluator interface, so each PUCTMCTS
+// search thread submits its leaves to the shared queue.
+struct QueuedEvaluator : public PUCTEvaluator {
+	EvalQueue &queue;
+
+	QueuedEvaluator(EvalQueue &queue) : queue(queue) {}
+
+	float evaluate(const GipfState &state, const vector<GipfMove> &moves,
+	               vector<float> &priors) override {
+		LeafEvaluation result = queue.evaluate(state, moves);
+		priors = std::move(result.priors);
+		return result.value;
+	}
+
+	vector<float> priors(const GipfState &state,
+	                     const vector<GipfMove> &moves) override {
+		return queue.evaluate(state, moves).priors;
+	}
+
+	float value(const GipfState &state) override {
+		return queue.evaluate(state, vector<GipfMove>()).value;
+	}
+};
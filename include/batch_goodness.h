@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include "board.h"
+
+/**
+  Static evaluation of many positions at once.
+
+  Positions are laid out as structure-of-arrays, one array per field, so
+  that the kernels load eight positions with a single instruction per
+  field. A kernel scores eight positions with vector popcounts against the
+  position_planes masks and integer multiply-adds for the material terms.
+  The AVX-512 kernel needs VPOPCNTDQ; the AVX2 kernel counts bits with a
+  nibble lookup table. The fastest one the CPU supports is picked at run
+  time, falling back to a scalar loop.
+
+  Every kernel returns exactly what GipfState::get_goodness would,
+  terminal positions included.
+*/
+
+enum class EvalKernel { SCALAR, AVX2, AVX512 };
+
+// Fields of `size` positions, each array `size` long.
+struct PositionArrays {
+	const uint64_t *board_1;
+	const uint64_t *board_2;
+	const int8_t *pieces_left_1;
+	const int8_t *pieces_left_2;
+	const char *player_to_move;
+	size_t size;
+};
+
+// Owns the arrays of a batch built from GipfStates. A template so that
+// this header, and with it src/batch_goodness.cpp, stays free of gtsa.
+struct PositionBatch {
+	std::vector<uint64_t> board_1, board_2;
+	std::vector<int8_t> pieces_left_1, pieces_left_2;
+	std::vector<char> player_to_move;
+
+	template <class State> void push_back(const State &state) {
+		board_1.push_back(state.board_1.board);
+		board_2.push_back(state.board_2.board);
+		pieces_left_1.push_back(state.pieces_left_1);
+		pieces_left_2.push_back(state.pieces_left_2);
+		player_to_move.push_back(state.player_to_move);
+	}
+
+	void reserve(size_t n) {
+		board_1.reserve(n);
+		board_2.reserve(n);
+		pieces_left_1.reserve(n);
+		pieces_left_2.reserve(n);
+		player_to_move.reserve(n);
+	}
+
+	void clear() {
+		board_1.clear();
+		board_2.clear();
+		pieces_left_1.clear();
+		pieces_left_2.clear();
+		player_to_move.clear();
+	}
+
+	size_t size() const { return board_1.size(); }
+
+	PositionArrays arrays() const {
+		return PositionArrays{board_1.data(), board_2.data(),
+		                      pieces_left_1.data(), pieces_left_2.data(),
+		                      player_to_move.data(), size()};
+	}
+};
+
+bool eval_kernel_supported(EvalKernel kernel);
+const char *eval_kernel_name(EvalKernel kernel);
+
+// The fastest kernel this CPU supports.
+EvalKernel best_eval_kernel();
+
+// Writes get_goodness of every position to `out`. Throws
+// invalid_argument if `kernel` is not supported here.
+void batch_goodness(const PositionArrays &positions, int *out,
+                    EvalKernel kernel);
+
+inline void batch_goodness(const PositionArrays &positions, int *out) {
+	batch_goodness(positions, out, best_eval_kernel());
+}
+
+inline void batch_goodness(const PositionBatch &batch, int *out) {
+	batch_goodness(batch.arrays(), out);
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+/**
+  The parts of the engine that do not depend on gtsa: boards, capture sets
+  and the helpers gipf.h builds on, some defined in src/gipf.cpp.
+
+  The gipf_engine library is compiled from this header and utils.h alone.
+  gtsa.hpp is only ever included by the translation unit of a program or
+  of the Python module, so it may define whatever it likes out of line
+  without clashing with the library at link time.
+*/
+
+using llint = long long int;
+using ullint = unsigned long long int;
+
+// The rows a move removes. They never overlap, so their order does not
+// matter and equality ignores it. Stored inline so that moves never touch
+// the heap. Each row holds four pieces of one colour, so a move removes at
+// most 3 rows per colour.
+struct GipfCaptures {
+	static constexpr int capacity = 8;
+	llint rows[capacity] = {};
+	int count = 0;
+
+	GipfCaptures() {}
+
+	GipfCaptures(const std::vector<llint> &masks) {
+		for (auto mask : masks)
+			push_back(mask);
+	}
+
+	void push_back(llint row) {
+		assert(count < capacity);
+		rows[count++] = row;
+	}
+
+	bool empty() const { return count == 0; }
+	int size() const { return count; }
+	const llint *begin() const { return rows; }
+	const llint *end() const { return rows + count; }
+
+	bool operator==(const GipfCaptures &other) const {
+		if (count != other.count)
+			return false;
+		for (auto row : *this) {
+			if (std::find(other.begin(), other.end(), row) == other.end())
+				return false;
+		}
+		return true;
+	}
+};
+
+struct Board {
+	ullint board = 0;
+
+	Board() {}
+
+	void set(int x, int y, ullint value) {
+		const ullint bit = 1ULL << (60 - (COLSUMS[x] + y));
+		board = value ? (board | bit) : (board & ~bit);
+	}
+
+	bool get(int x, int y) const {
+		ullint i = 60 - (COLSUMS[x] + y);
+		return (board >> i) & 1;
+	}
+
+	bool operator==(const Board &other) const { return board == other.board; }
+
+	// True if the line entered at `elt` towards `dir` has an empty cell.
+	bool CanMove(llint elt, direction dir) const {
+		return (line_mask(elt, dir) & ~board) != 0;
+	}
+
+	// Pushes a piece in from `elt` towards `dir`: every piece between the
+	// entry point and the first empty cell of the line moves one step.
+	// `combined` is the union of both boards and is updated alongside.
+	void SlidePieces(llint elt, direction dir, Board &combined) {
+		const llint line = line_mask(elt, dir);
+		const llint empty = line & ~combined.board;
+		if (empty == 0)
+			return;
+
+		llint run;
+		if (towards_low_bits(dir)) {
+			run = line & ~(highest_bit(empty) - 1);
+		} else {
+			run = line & ((lowest_bit(empty) << 1) - 1);
+		}
+		board = (board & ~run) | step_cells(elt, dir) |
+		        step_cells(board & run, dir);
+		combined.board |= run;
+	}
+};
+
+// Most ways of resolving the rows formed by one push, i.e. maximal sets of
+// pairwise disjoint rows. Positions never hold a row between moves and
+// never more than 15 pieces of a colour, so
+//  - a push only changes cells of its own line L, and every row it forms
+//    runs through a changed cell: the row lies on L or crosses it,
+//  - no line has 8 cells, room for two disjoint runs of four, so a line
+//    holds at most one row, and
+//  - the rows crossing L along one axis lie on parallel lines, so they are
+//    disjoint and hold four pieces each: at most 3 per colour, 6 in all.
+// The rows on the two crossing axes form a bipartite conflict graph, and a
+// maximal set is fixed by its rows on one axis, so there are at most 2^6.
+// The row on L, if any, at most doubles that.
+const int MAX_CAPTURE_SETS = 2 * 64;
+
+// Most moves GipfState::generate_moves lists for one position: each of the
+// 42 entry pushes gives one move without captures or one per capture set.
+const int MAX_MOVES = 42 * MAX_CAPTURE_SETS;
+
+// Bron-Kerbosch over the complement of the conflict graph of `rows`:
+// `chosen` is the set being built, `candidates` the rows that may still
+// join it and `excluded` the rows already covered by an earlier branch.
+// Calls `visit` with each maximal set.
+template <class Visit>
+void enumerate_capture_sets(const llint *rows, const uint32_t *conflicts,
+                            uint32_t candidates, uint32_t excluded,
+                            uint32_t chosen, Visit &visit) {
+	if (candidates == 0) {
+		if (excluded == 0) {
+			GipfCaptures set;
+			for (uint32_t c = chosen; c; c &= c - 1) {
+				set.push_back(rows[__builtin_ctz(c)]);
+			}
+			visit(set);
+		}
+		return;
+	}
+	while (candidates) {
+		uint32_t v = candidates & -candidates;
+		uint32_t keep = ~(conflicts[__builtin_ctz(v)] | v);
+		enumerate_capture_sets(rows, conflicts, candidates & keep,
+		                       excluded & keep, chosen | v, visit);
+		candidates &= ~v;
+		excluded |= v;
+	}
+}
+
+// Fills the boards and reserves from a GipfState initialization string.
+// Throws invalid_argument if the string does not describe a position,
+// including one with a four-in-a-row left on the board.
+void read_position(const std::string &init_string, Board &board_1,
+                   Board &board_2, int &pieces_left_1, int &pieces_left_2);
+
+// Draws the boards and reserves as GipfState::to_stream prints them.
+std::ostream &write_position(std::ostream &os, const Board &board_1,
+                             const Board &board_2, int pieces_left_1,
+                             int pieces_left_2);
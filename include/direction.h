@@ -1,5 +1,7 @@
 #pragma once
 
+#include <istream>
+
 /**
        N
   SW   |   NE
@@ -19,9 +21,14 @@ enum class direction {
 };
 
 
-std::istream &operator>>(std::istream &is, direction &i) {
+inline std::istream &operator>>(std::istream &is, direction &i) {
 	int tmp;
 	if (is >> tmp)
 		i = static_cast<direction>(tmp);
 	return is;
 }
+
+inline const char *direction_name(direction dir) {
+	static const char *const names[] = {"N", "S", "NE", "NW", "SE", "SW"};
+	return names[static_cast<int>(dir)];
+}
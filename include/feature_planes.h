@@ -0,0 +1,106 @@
+#pragma once
+
+#include <type_traits>
+
+#include "gipf.h"
+
+/**
+  Neural-network input encoding.
+
+  A state becomes FEATURE_PLANES planes of GRID_SIZE x GRID_SIZE values,
+  seen from the player to move. The hex board sits on the grid in axial
+  coordinates: cell (x, y) goes to row y + max(0, x - 4) and column x. Every
+  direction is then a fixed grid offset, so convolutions see the true hex
+  neighbourhood. Grid cells outside the board are zero in every plane
+  except PLANE_ON_BOARD.
+
+  Reserve planes hold pieces_left / 15 for floating-point outputs and the
+  raw count for integral ones.
+*/
+
+enum FeaturePlane {
+	PLANE_OWN,
+	PLANE_ENEMY,
+	PLANE_OWN_RESERVE,
+	PLANE_ENEMY_RESERVE,
+	// All ones when PLAYER_1 is to move.
+	PLANE_SIDE,
+	PLANE_ON_BOARD,
+	FEATURE_PLANES
+};
+
+const int GRID_SIZE = 9;
+const int GRID_CELLS = GRID_SIZE * GRID_SIZE;
+const int FEATURE_SIZE = FEATURE_PLANES * GRID_CELLS;
+// One legal-move mask entry per entry_pushes element.
+const int PUSH_COUNT = 42;
+static_assert(std::tuple_size<decltype(entry_pushes)>::value == PUSH_COUNT,
+              "one mask entry per push");
+
+constexpr std::array<int, 61> build_grid_index() {
+	std::array<int, 61> index{};
+	for (int x = 0; x < 9; x++) {
+		for (int y = 0; y < COLLEN[x]; y++) {
+			const int row = y + std::max(0, x - 4);
+			index[60 - (COLSUMS[x] + y)] = row * GRID_SIZE + x;
+		}
+	}
+	return index;
+}
+
+// Grid position (row * GRID_SIZE + column) of each bit.
+constexpr std::array<int, 61> grid_index = build_grid_index();
+
+template <class T> T reserve_feature(int pieces_left) {
+	return std::is_floating_point<T>::value ? T(pieces_left / 15.0)
+	                                        : T(pieces_left);
+}
+
+template <class T> void fill_plane(T *plane, int64_t cells) {
+	for (; cells; cells &= cells - 1)
+		plane[grid_index[__builtin_ctzll(cells)]] = 1;
+}
+
+// Writes FEATURE_SIZE values for `state` to `out`.
+template <class T> void encode_planes(const GipfState &state, T *out) {
+	const bool first = state.player_to_move == PLAYER_1;
+	const Board &own = first ? state.board_1 : state.board_2;
+	const Board &enemy = first ? state.board_2 : state.board_1;
+
+	std::fill(out, out + FEATURE_SIZE, T(0));
+	fill_plane(out + PLANE_OWN * GRID_CELLS, own.board);
+	fill_plane(out + PLANE_ENEMY * GRID_CELLS, enemy.board);
+	fill_plane(out + PLANE_ON_BOARD * GRID_CELLS, (1LL << 61) - 1);
+
+	const T own_reserve = reserve_feature<T>(first ? state.pieces_left_1
+	                                               : state.pieces_left_2);
+	const T enemy_reserve = reserve_feature<T>(first ? state.pieces_left_2
+	                                                 : state.pieces_left_1);
+	for (int i = 0; i < 61; i++) {
+		const int cell = grid_index[i];
+		out[PLANE_OWN_RESERVE * GRID_CELLS + cell] = own_reserve;
+		out[PLANE_ENEMY_RESERVE * GRID_CELLS + cell] = enemy_reserve;
+		out[PLANE_SIDE * GRID_CELLS + cell] = first;
+	}
+}
+
+// Writes PUSH_COUNT values for `state` to `out`: 1 where the push in
+// entry_pushes is legal, whatever its capture choices, and 0 elsewhere.
+template <class T> void encode_legal_pushes(const GipfState &state, T *out) {
+	for (int i = 0; i < PUSH_COUNT; i++)
+		out[i] = state.is_legal_push(i);
+}
+
+// Batched forms writing [n, FEATURE_PLANES, GRID_SIZE, GRID_SIZE] and
+// [n, PUSH_COUNT] arrays.
+template <class T>
+void encode_planes(const GipfState *const *states, size_t n, T *out) {
+	for (size_t i = 0; i < n; i++)
+		encode_planes(*states[i], out + i * FEATURE_SIZE);
+}
+
+template <class T>
+void encode_legal_pushes(const GipfState *const *states, size_t n, T *out) {
+	for (size_t i = 0; i < n; i++)
+		encode_legal_pushes(*states[i], out + i * PUSH_COUNT);
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gipf.h"
+
+/**
+  Binary game records.
+
+  A record file is a GameRecordFileHeader followed by any number of game
+  records. Each record is a GameRecordHeader, `n_moves` PackedMoves padded to
+  a multiple of 8 bytes and, if the header has RECORD_HAS_STATS set,
+  `n_moves` MoveStats. Every record starts 8-byte aligned, so a file can be
+  memory-mapped and read in place. Games always start from GipfState().
+
+  A packed move is its index into entry_pushes plus the index of its
+  capture choice in GipfState::FindCaptureSets, so the capture rows are
+  recovered by replaying the game. Fields are little-endian.
+*/
+
+const char GAME_RECORD_MAGIC[8] = {'G', 'I', 'P', 'F', 'R', 'E', 'C', 0};
+const uint32_t GAME_RECORD_VERSION = 1;
+const uint32_t RECORD_HAS_STATS = 1;
+
+struct GameRecordFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+struct GameRecordHeader {
+	uint32_t n_moves;
+	uint32_t flags;
+	uint64_t seed;
+	uint64_t game;
+	// PLAYER_1, PLAYER_2 or EMPTY for a draw.
+	char winner;
+	uint8_t reserved[7];
+};
+
+struct PackedMove {
+	// Index into entry_pushes.
+	uint8_t push;
+	// 0 if the move captures nothing, otherwise 1 + the index of its set in
+	// FindCaptureSets for the position after the push.
+	uint8_t choice;
+};
+
+static_assert(MAX_CAPTURE_SETS < 256, "capture choices must fit a byte");
+
+// Optional search statistics for the position a move was played from.
+struct MoveStats {
+	uint32_t simulations;
+	// Expected score of the chosen move for the player making it, in [0, 1].
+	float value;
+};
+
+static_assert(sizeof(GameRecordFileHeader) == 16, "unexpected padding");
+static_assert(sizeof(GameRecordHeader) == 32, "unexpected padding");
+static_assert(sizeof(PackedMove) == 2, "unexpected padding");
+static_assert(sizeof(MoveStats) == 8, "unexpected padding");
+
+inline size_t packed_moves_size(uint32_t n_moves) {
+	return (n_moves * sizeof(PackedMove) + 7) & ~size_t(7);
+}
+
+inline size_t game_record_size(const GameRecordHeader &header) {
+	size_t size =
+	    sizeof(GameRecordHeader) + packed_moves_size(header.n_moves);
+	if (header.flags & RECORD_HAS_STATS)
+		size += header.n_moves * sizeof(MoveStats);
+	return size;
+}
+
+// Calls `visit` with the capture choices for playing `push` in `state`;
+// returns how many there are.
+template <class Visit>
+int capture_sets_after(const GipfState &state, const Push &push,
+                       Visit &&visit) {
+	Board own = (state.player_to_move == PLAYER_1) ? state.board_1
+	                                               : state.board_2;
+	Board combined = state.combined;
+	own.SlidePieces(push.elt, push.dir, combined);
+	return GipfState::FindCaptureSets(own.board, combined.board & ~own.board,
+	                                  combined.board, visit);
+}
+
+inline PackedMove pack_move(const GipfState &state, const GipfMove &move) {
+	const int push = move.elt ? push_index(move.elt, move.dir) : -1;
+	if (push < 0)
+		throw invalid_argument("Move does not start from an entry point");
+	PackedMove packed{uint8_t(push), 0};
+	if (move.captures.empty())
+		return packed;
+
+	int i = 0;
+	capture_sets_after(state, entry_pushes[packed.push],
+	                   [&](const GipfCaptures &set) {
+		                   i++;
+		                   if (!packed.choice && set == move.captures)
+			                   packed.choice = i;
+	                   });
+	if (!packed.choice)
+		throw invalid_argument("Move captures are not a legal capture choice");
+	return packed;
+}
+
+inline GipfMove unpack_move(const GipfState &state, PackedMove packed) {
+	const Push &push = entry_pushes.at(packed.push);
+	if (packed.choice == 0)
+		return GipfMove(push.elt, push.dir);
+
+	GipfCaptures chosen;
+	int i = 0;
+	int n_sets = capture_sets_after(state, push, [&](const GipfCaptures &set) {
+		if (++i == packed.choice)
+			chosen = set;
+	});
+	if (packed.choice > n_sets)
+		throw runtime_error("Corrupt game record: bad capture choice");
+	return GipfMove(push.elt, push.dir, chosen);
+}
+
+// Collects the moves of one game as it is played.
+struct GameRecordBuilder {
+	GameRecordHeader header{};
+	vector<PackedMove> moves;
+	vector<MoveStats> stats;
+
+	GameRecordBuilder(uint64_t game = 0, uint64_t seed = 0) {
+		header.game = game;
+		header.seed = seed;
+		header.winner = EMPTY;
+	}
+
+	// `state` is the position `move` is played from.
+	void add(const GipfState &state, const GipfMove &move) {
+		moves.push_back(pack_move(state, move));
+	}
+
+	void add(const GipfState &state, const GipfMove &move,
+	         const MoveStats &move_stats) {
+		add(state, move);
+		stats.push_back(move_stats);
+	}
+
+	void finish(char winner) { header.winner = winner; }
+};
+
+// Appends game records to a file. Safe to share between threads: records
+// are encoded outside the lock and written with a single fwrite each.
+class GameRecordWriter {
+  public:
+	GameRecordWriter(const string &path) {
+		file = fopen(path.c_str(), "ab+");
+		if (!file)
+			throw runtime_error("Cannot open " + path);
+		GameRecordFileHeader header{};
+		fseek(file, 0, SEEK_END);
+		if (ftell(file) == 0) {
+			memcpy(header.magic, GAME_RECORD_MAGIC, sizeof(header.magic));
+			header.version = GAME_RECORD_VERSION;
+			fwrite(&header, sizeof(header), 1, file);
+			return;
+		}
+
+		rewind(file);
+		if (fread(&header, sizeof(header), 1, file) != 1 ||
+		    memcmp(header.magic, GAME_RECORD_MAGIC, sizeof(header.magic)) ||
+		    header.version != GAME_RECORD_VERSION) {
+			fclose(file);
+			throw runtime_error("Not a game record file: " + path);
+		}
+	}
+
+	GameRecordWriter(const GameRecordWriter &) = delete;
+	GameRecordWriter &operator=(const GameRecordWriter &) = delete;
+
+	~GameRecordWriter() { fclose(file); }
+
+	void write(const GameRecordBuilder &game) {
+		GameRecordHeader header = game.header;
+		header.n_moves = game.moves.size();
+		header.flags = 0;
+		if (!game.stats.empty()) {
+			assert(game.stats.size() == game.moves.size());
+			header.flags |= RECORD_HAS_STATS;
+		}
+
+		vector<char> buffer(game_record_size(header), 0);
+		char *out = buffer.data();
+		memcpy(out, &header, sizeof(header));
+		out += sizeof(header);
+		memcpy(out, game.moves.data(), header.n_moves * sizeof(PackedMove));
+		out += packed_moves_size(header.n_moves);
+		if (header.flags & RECORD_HAS_STATS)
+			memcpy(out, game.stats.data(), header.n_moves * sizeof(MoveStats));
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (fwrite(buffer.data(), buffer.size(), 1, file) != 1)
+			throw runtime_error("Failed to write game record");
+	}
+
+	void flush() {
+		std::lock_guard<std::mutex> lock(mutex);
+		fflush(file);
+	}
+
+  private:
+	FILE *file;
+	std::mutex mutex;
+};
+
+// A game inside a mapped record file. Points into the mapping, so it is
+// only valid while the reader is alive.
+struct GameRecordView {
+	const GameRecordHeader *header = nullptr;
+	const PackedMove *moves = nullptr;
+	// Null unless the record has RECORD_HAS_STATS.
+	const MoveStats *stats = nullptr;
+};
+
+// Memory-maps a record file and walks its games in place.
+class GameRecordReader {
+  public:
+	GameRecordReader(const string &path) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw runtime_error("Cannot open " + path);
+		struct stat info;
+		if (fstat(fd, &info) != 0 ||
+		    info.st_size < (off_t)sizeof(GameRecordFileHeader)) {
+			close(fd);
+			throw runtime_error("Not a game record file: " + path);
+		}
+		length = info.st_size;
+		void *mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			throw runtime_error("Cannot map " + path);
+		bytes = static_cast<const char *>(mapped);
+
+		const auto *header =
+		    reinterpret_cast<const GameRecordFileHeader *>(bytes);
+		if (memcmp(header->magic, GAME_RECORD_MAGIC,
+		           sizeof(header->magic)) ||
+		    header->version != GAME_RECORD_VERSION) {
+			munmap(mapped, length);
+			throw runtime_error("Not a game record file: " + path);
+		}
+		cursor = sizeof(GameRecordFileHeader);
+	}
+
+	GameRecordReader(const GameRecordReader &) = delete;
+	GameRecordReader &operator=(const GameRecordReader &) = delete;
+
+	~GameRecordReader() { munmap(const_cast<char *>(bytes), length); }
+
+	const char *data() const { return bytes; }
+	size_t size() const { return length; }
+
+	// Reads the game at the cursor into `game` and advances. Returns false
+	// at the end of the file or at a truncated trailing record.
+	bool next(GameRecordView &game) {
+		if (!view_at(cursor, game))
+			return false;
+		cursor += game_record_size(*game.header);
+		return true;
+	}
+
+	void rewind() { cursor = sizeof(GameRecordFileHeader); }
+
+	// Byte offset of every complete game, built on first use.
+	const vector<uint64_t> &index() {
+		if (offsets.empty()) {
+			GameRecordView game;
+			for (size_t offset = sizeof(GameRecordFileHeader);
+			     view_at(offset, game);
+			     offset += game_record_size(*game.header)) {
+				offsets.push_back(offset);
+			}
+		}
+		return offsets;
+	}
+
+	size_t game_count() { return index().size(); }
+
+	GameRecordView game(size_t i) {
+		GameRecordView view;
+		view_at(index().at(i), view);
+		return view;
+	}
+
+  private:
+	const char *bytes = nullptr;
+	size_t length = 0;
+	size_t cursor = 0;
+	vector<uint64_t> offsets;
+
+	bool view_at(size_t offset, GameRecordView &game) const {
+		if (offset + sizeof(GameRecordHeader) > length)
+			return false;
+		const auto *header =
+		    reinterpret_cast<const GameRecordHeader *>(bytes + offset);
+		if (offset + game_record_size(*header) > length)
+			return false;
+
+		game.header = header;
+		game.moves = reinterpret_cast<const PackedMove *>(header + 1);
+		game.stats = nullptr;
+		if (header->flags & RECORD_HAS_STATS) {
+			game.stats = reinterpret_cast<const MoveStats *>(
+			    reinterpret_cast<const char *>(game.moves) +
+			    packed_moves_size(header->n_moves));
+		}
+		return true;
+	}
+};
+
+// Steps through the positions of a recorded game without allocating.
+struct GameReplay {
+	GameRecordView game;
+	GipfState state;
+	uint32_t ply = 0;
+
+	GameReplay(const GameRecordView &game) : game(game) {}
+
+	bool done() const { return ply >= game.header->n_moves; }
+
+	// The move about to be played from `state`.
+	GipfMove move() const { return unpack_move(state, game.moves[ply]); }
+
+	// Plays the next move. Returns false once the game is over.
+	bool next() {
+		if (done())
+			return false;
+		state.apply_move(move());
+		ply++;
+		return true;
+	}
+};
@@ -1,23 +1,31 @@
+#pragma once
+
+#include <algorithm>
 #include <bitset>
 #include <boost/functional/hash.hpp>
+#include <cassert>
 #include <climits>
 #include <cmath>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 
+#include "board.h"
 #include "gtsa.hpp"
-#include "utils.h"
-
-using llint = long long int;
-using ullint = unsigned long long int;
+#include "search_phase.h"
+#include "zobrist.h"
 
 struct GipfMove : public Move<GipfMove> {
 	llint elt;
 	direction dir;
-	vector<llint> captures;
+	GipfCaptures captures;
 
 	GipfMove() {}
 
-	GipfMove(llint elt, direction dir, vector<llint> captures) : elt(elt), dir(dir), captures(captures) {}
+	GipfMove(llint elt, direction dir,
+	         const GipfCaptures &captures = GipfCaptures())
+	    : elt(elt), dir(dir), captures(captures) {}
 
 	void read(istream &stream = cin) override {
 		if (&stream == &cin) {
@@ -29,7 +37,7 @@ struct GipfMove : public Move<GipfMove> {
 	}
 
 	ostream &to_stream(ostream &os) const override {
-		return os << elt << ", " << m[dir];
+		return os << elt << ", " << direction_name(dir);
 	}
 
 	bool operator==(const GipfMove &rhs) const override {
@@ -37,157 +45,142 @@ struct GipfMove : public Move<GipfMove> {
 	}
 
 	size_t hash() const override {
-		using boost::hash_combine;
-		using boost::hash_value;
-		size_t seed = 0;
-		hash_combine(seed, hash_value(elt));
-		hash_combine(seed, hash_value(dir));
+		uint64_t seed = elt * 0x9E3779B97F4A7C15ULL + static_cast<int>(dir);
+		// Summed so that the order of the captured rows does not matter.
+		uint64_t rows = 0;
 		for (auto capture : captures) {
-			hash_combine(seed, hash_value(capture));
+			rows += (capture ^ (capture >> 29)) * 0xBF58476D1CE4E5B9ULL;
 		}
-		return seed;
+		seed = (seed ^ rows) * 0x94D049BB133111EBULL;
+		return seed ^ (seed >> 31);
 	}
 };
 
-struct Board {
-	ullint board = 0;
-
-	Board() {}
-
-	Board(const Board &other) { board = other.board; }
-
-	void set(int x, int y, ullint value) {
-		board = board & (1 << (60 - (COLSUMS[x] + y)));
+// List of moves filled by GipfState::generate_moves. clear() keeps the
+// storage, so a list reused from one position to the next, like the
+// per-ply lists of AlphaBeta, stops allocating once it has grown to the
+// largest position seen. Movable but not copyable.
+class GipfMoveList {
+  public:
+	GipfMoveList() {}
+	GipfMoveList(GipfMoveList &&) = default;
+	GipfMoveList &operator=(GipfMoveList &&) = default;
+
+	void emplace(llint elt, direction dir, const GipfCaptures &captures) {
+		moves.emplace_back(elt, dir, captures);
 	}
 
-	bool get(int x, int y) const {
-		ullint i = 60 - (COLSUMS[x] + y);
-		return (board >> i) & 1;
-	}
+	void reserve(int n) { moves.reserve(n); }
+	void clear() { moves.clear(); }
+	int size() const { return moves.size(); }
+	bool empty() const { return moves.empty(); }
 
-	bool operator==(const Board &other) const { return board == other.board; }
-
-	bool CanMove(llint elt, direction dir) const {
-		llint next;
-		if (next_element.at(dir).find(elt) != next_element.at(dir).end())
-			next = next_element.at(dir).at(elt);
-		else
-			next = 0;
-
-		while (in_board(next) && next != 0) {
-			if ((board & next) == 0)
-				return true;
-			next = next_element.at(dir)[next];
-			if (next_element.at(dir).find(next) != next_element.at(dir).end()) {
-				next = next_element.at(dir).at(next);
-			}
-			else {
-				next = 0;
-			}
-		}
-		return false;
-	}
+	const GipfMove &operator[](int i) const { return moves[i]; }
+	const GipfMove *begin() const { return moves.data(); }
+	const GipfMove *end() const { return moves.data() + moves.size(); }
 
-	void SlidePieces(llint elt, direction dir, Board &combined) {
-		llint next;
-		if (next_element.at(dir).find(elt) != next_element.at(dir).end())
-			next = next_element.at(dir).at(elt);
-		else
-			next = 0;
-		llint mask_board = next;
-		llint mask_combined = next;
-		llint curr = elt;
-		while (in_board(next) && (next != 0)) {
-			bool next_empty = (combined.board & next) == 0;
-			if (board & curr) {
-				board &= (~curr);
-				mask_board |= next;
-			}
-			mask_combined |= next;
-			if (next_empty) {
-				break;
-			}
-			curr = next;
-			if (next_element.at(dir).find(next) != next_element.at(dir).end()) {
-				next = next_element.at(dir).at(next);
-			}
-			else {
-				next = 0;
-			}
-		}
-		board |= mask_board;
-		combined.board |= mask_combined;
-	}
+  private:
+	std::vector<GipfMove> moves;
 };
 
-size_t hash_value(const Board &board) {
+inline size_t hash_value(const Board &board) {
 	hash<ullint> hash_fn;
 	return hash_fn(board.board);
 }
 
-struct GipfState : public State<GipfState, GipfMove> {
-
+// Everything about a position except the side to move, which lives in
+// State. Trivially copyable, so make_move snapshots it with a plain copy.
+struct GipfPosition {
 	Board board_1, board_2, combined;
-	llint pieces_left_1, pieces_left_2;
-	std::vector<GipfState> history;
+	// Zobrist key of the position, maintained incrementally by SlidePieces,
+	// ResolveRow, make_move and undo_move.
+	uint64_t key = 0;
+	// Static evaluation from player 1's point of view, ignoring terminal
+	// positions. Maintained alongside the key.
+	int eval = 0;
+	int pieces_left_1 = 15, pieces_left_2 = 15;
+	// Bit i is set if entry_pushes[i] is legal. Maintained alongside the
+	// key.
+	uint64_t legal_pushes = 0;
+};
 
-	GipfState() : history(0), State(PLAYER_1) {
-		pieces_left_1 = 15;
-		pieces_left_2 = 15;
-	}
+static_assert(std::is_trivially_copyable<GipfPosition>::value,
+              "GipfPosition must stay trivially copyable");
+static_assert(sizeof(GipfPosition) <= 56, "GipfPosition grew unexpectedly");
 
-	GipfState(const string &init_string) : history(0), State(PLAYER_1) {
-		pieces_left_1 = 15;
-		pieces_left_2 = 15;
+struct GipfUndo {
+	GipfPosition position;
+	char player_to_move;
+};
 
-		const unsigned long length = init_string.length();
-		const unsigned long correct_length = 61;
-		if (length != correct_length) {
-			throw invalid_argument("Initialization string length must be " +
-			                       to_string(correct_length));
-		}
-		for (auto c : init_string) {
-			if (c != PLAYER_1 && c != PLAYER_2 && c != EMPTY) {
-				throw invalid_argument(string("Undefined symbol used: '") + c +
-				                       "'");
-			}
-		}
+// Fixed-capacity stack of positions to return to on undo_move. Once full,
+// pushing drops the oldest entry, so arbitrarily long playouts run without
+// growing it while search can still undo up to `capacity` plies.
+//
+// Storage is allocated on the first push and copies start out empty: undo
+// history belongs to the state that made the moves, which keeps copying a
+// GipfState O(1) at any point in the game.
+class GipfUndoStack {
+  public:
+	static constexpr int capacity = 256;
+
+	GipfUndoStack() {}
+	GipfUndoStack(const GipfUndoStack &) {}
+	GipfUndoStack &operator=(const GipfUndoStack &) {
+		top = 0;
+		depth = 0;
+		return *this;
+	}
 
-		for (int y = 0; y < 9; ++y) {
-			for (int x = 0; x < 9 - abs(y - 4); ++x) {
-				const char c = init_string[y * COLLEN[y] + x];
-				if (c == PLAYER_1) {
-					board_1.set(x, y, 1);
-					pieces_left_1--;
-				} else if (c == PLAYER_2) {
-					board_2.set(x, y, 1);
-					pieces_left_2--;
-				}
-			}
-		}
-		combined.board = board_1.board | board_2.board;
+	void push(const GipfUndo &undo) {
+		if (!entries)
+			entries.reset(new GipfUndo[capacity]);
+		entries[top] = undo;
+		top = (top + 1) % capacity;
+		depth = std::min(depth + 1, capacity);
 	}
 
-	GipfState clone() const override {
-		auto clone = history_clone();
-		clone.history = history;
-		return clone;
+	const GipfUndo &pop() {
+		assert(depth > 0 && "undo_move past the start of the undo history");
+		depth--;
+		top = (top + capacity - 1) % capacity;
+		return entries[top];
 	}
 
-	GipfState history_clone() const {
-		auto clone = GipfState();
-		clone.board_1 = board_1;
-		clone.board_2 = board_2;
-		clone.combined = combined;
-		clone.pieces_left_1 = pieces_left_1;
-		clone.pieces_left_2 = pieces_left_2;
-		clone.player_to_move = player_to_move;
-		return clone;
+	int size() const { return depth; }
+
+  private:
+	std::unique_ptr<GipfUndo[]> entries;
+	int top = 0;
+	int depth = 0;
+};
+
+struct GipfState : public State<GipfState, GipfMove>, public GipfPosition {
+
+	GipfUndoStack history;
+
+	GipfState() : State(PLAYER_1) {
+		key = compute_key();
+		eval = compute_eval();
+		legal_pushes = legal_push_mask(combined.board);
 	}
 
+	// `init_string` has one character per cell in cell order, i.e. column
+	// by column from A and bottom to top within a column. Edge cells must be
+	// empty, and each player's reserve is 15 minus their pieces on the board.
+	GipfState(const string &init_string) : State(PLAYER_1) {
+		read_position(init_string, board_1, board_2, pieces_left_1,
+		              pieces_left_2);
+		combined.board = board_1.board | board_2.board;
+		key = compute_key();
+		eval = compute_eval();
+		legal_pushes = legal_push_mask(combined.board);
+	}
+
+	GipfState clone() const override { return *this; }
+
 	int get_reserve_value(int pieces_left) const {
-		return pieces_left *
-		       (280 - std::floor(std::cbrt(pieces_left - 1) * 20));
+		return reserve_values[pieces_left];
 	}
 
 	int get_goodness() const override {
@@ -200,55 +193,51 @@ struct GipfState : public State<GipfState, GipfMove> {
 				return 0;
 			}
 		}
+		return (player_to_move == PLAYER_2) ? -eval : eval;
+	}
 
-		int score =
-		    get_reserve_value(pieces_left_1) - get_reserve_value(pieces_left_2);
-
-		auto pieces_board_1 = no_of_set_bits(board_1.board);
-		auto pieces_board_2 = no_of_set_bits(board_2.board);
-		score += (pieces_board_1 - pieces_board_2) * 230;
-
-		int pieces_dead_1 = 15 - pieces_left_1 - pieces_board_1;
-		int pieces_dead_2 = 15 - pieces_left_2 - pieces_board_2;
-		score += (pieces_dead_2 - pieces_dead_1) *
-		         (pieces_dead_2 + pieces_dead_1) * 10;
-
-		llint x = 1LL<<60;
-		while (x > 0) {
-			score += position_scores[board_1.board & x];
-			score -= position_scores[board_2.board & x];
-			x >>= 1;
-		}
-
-		if (player_to_move == PLAYER_2) {
-			score *= -1;
-		}
-
-		return score;
+	int compute_eval() const {
+		return material_score(board_1.board, board_2.board, pieces_left_1,
+		                      pieces_left_2) +
+		       positional_score(board_1.board) -
+		       positional_score(board_2.board);
 	}
 
-	vector<GipfMove> get_legal_moves(int max_moves = INF) const override {
-		vector<GipfMove> moves;
-		for (auto eltdir : possible_directions) {
-			for (auto dir : eltdir.second) {
-				if (!combined.CanMove(eltdir.first, dir))
-					continue;
+	// Every legal move; the cap gtsa allows for is not applied.
+	vector<GipfMove> get_legal_moves(int = INF) const override {
+		GipfMoveList list;
+		generate_moves(list);
+		return vector<GipfMove>(list.begin(), list.end());
+	}
 
-				auto dirty_state = clone();
-				dirty_state.SlidePieces(eltdir.first, dir);
-				auto capture_mask_sets = dirty_state.GetCaptureMaskSets();
+	// Whether entry_pushes[push] is legal, and how many pushes are.
+	bool is_legal_push(int push) const { return legal_pushes >> push & 1; }
+	int count_legal_pushes() const {
+		return __builtin_popcountll(legal_pushes);
+	}
 
-				if (capture_mask_sets.empty()) {
-					moves.emplace_back(eltdir.first, dir, vector<llint>(0));
-				}
-				else {
-					for (const auto& mask_set : capture_mask_sets) {
-						moves.emplace_back(eltdir.first, dir, mask_set);
-					}
-				}
+	// Appends every legal move to `list`. Each push is played out on copies
+	// of the three boards, so the state is not touched, and `list` only
+	// allocates if it has never held this many moves.
+	void generate_moves(GipfMoveList &list) const {
+		GIPF_PHASE(PHASE_MOVEGEN);
+		const Board &own = (player_to_move == PLAYER_1) ? board_1 : board_2;
+		list.reserve(list.size() + count_legal_pushes());
+
+		for (uint64_t pushes = legal_pushes; pushes; pushes &= pushes - 1) {
+			const Push &push = entry_pushes[__builtin_ctzll(pushes)];
+			Board after = own, after_combined = combined;
+			after.SlidePieces(push.elt, push.dir, after_combined);
+			int n_sets = FindCaptureSets(
+			    after.board, after_combined.board & ~after.board,
+			    after_combined.board, [&](const GipfCaptures &set) {
+				    list.emplace(push.elt, push.dir, set);
+			    });
+
+			if (n_sets == 0) {
+				list.emplace(push.elt, push.dir, GipfCaptures());
 			}
 		}
-		return moves;
 	}
 
 	char get_enemy(char player) const override {
@@ -276,8 +265,13 @@ struct GipfState : public State<GipfState, GipfMove> {
 		auto &pieces_left =
 		    (player_to_move == PLAYER_1) ? pieces_left_1 : pieces_left_2;
 
+#ifndef NDEBUG
 		auto pieces_board_1 = no_of_set_bits(board.board);
 		auto pieces_board_2 = no_of_set_bits(other_board.board);
+#endif
+
+		const ullint old_1 = board_1.board, old_2 = board_2.board;
+		const int old_left_1 = pieces_left_1, old_left_2 = pieces_left_2;
 
 		board.SlidePieces(elt, dir, combined);
 		other_board.board = combined.board & (~board.board);
@@ -287,10 +281,17 @@ struct GipfState : public State<GipfState, GipfMove> {
 		assert(pieces_board_2 == (no_of_set_bits(other_board.board)));
 
 		pieces_left--;
+		update_incremental(old_1, old_2, old_left_1, old_left_2);
 	}
 
 	void make_move(const GipfMove &move) override {
-		history.push_back(history_clone());
+		history.push({*this, player_to_move});
+		apply_move(move);
+	}
+
+	// make_move without recording undo information, for playouts that
+	// never go back.
+	void apply_move(const GipfMove &move) {
 		SlidePieces(move.elt, move.dir);
 
 		for (auto capture : move.captures) {
@@ -298,9 +299,16 @@ struct GipfState : public State<GipfState, GipfMove> {
 		}
 
 		player_to_move = get_enemy(player_to_move);
+		key ^= zobrist.side;
+		assert(key == compute_key());
+		assert(eval == compute_eval());
+		assert(legal_pushes == legal_push_mask(combined.board));
 	}
 
 	void ResolveRow(llint row) {
+		const ullint old_1 = board_1.board, old_2 = board_2.board;
+		const int old_left_1 = pieces_left_1, old_left_2 = pieces_left_2;
+
 		llint count1 = no_of_set_bits(board_1.board & row);
 		llint count2 = no_of_set_bits(board_2.board & row);
 		if (count2 >= 4) {
@@ -311,81 +319,125 @@ struct GipfState : public State<GipfState, GipfMove> {
 		board_1.board &= ~row;
 		board_2.board &= ~row;
 		combined.board = board_1.board | board_2.board;
+
+		update_incremental(old_1, old_2, old_left_1, old_left_2);
+	}
+
+	// Brings the key, the evaluation and the legal pushes up to date after
+	// the boards and reserves changed from the given values. Only the
+	// changed cells are visited.
+	void update_incremental(ullint old_1, ullint old_2, int old_left_1,
+	                        int old_left_2) {
+		legal_pushes =
+		    update_legal_pushes(legal_pushes, old_1 | old_2, combined.board);
+
+		key ^= zobrist_cells(0, old_1 ^ board_1.board) ^
+		       zobrist_cells(1, old_2 ^ board_2.board) ^
+		       zobrist_reserve(0, old_left_1) ^
+		       zobrist_reserve(0, pieces_left_1) ^
+		       zobrist_reserve(1, old_left_2) ^
+		       zobrist_reserve(1, pieces_left_2);
+
+		eval += material_score(board_1.board, board_2.board, pieces_left_1,
+		                       pieces_left_2) -
+		        material_score(old_1, old_2, old_left_1, old_left_2);
+		eval += cell_weights(board_1.board & ~old_1) -
+		        cell_weights(old_1 & ~board_1.board) -
+		        cell_weights(board_2.board & ~old_2) +
+		        cell_weights(old_2 & ~board_2.board);
+	}
+
+	uint64_t compute_key() const {
+		uint64_t full = zobrist_cells(0, board_1.board) ^
+		                zobrist_cells(1, board_2.board) ^
+		                zobrist_reserve(0, pieces_left_1) ^
+		                zobrist_reserve(1, pieces_left_2);
+		if (player_to_move == PLAYER_2)
+			full ^= zobrist.side;
+		return full;
 	}
 
 	vector<vector<llint>> GetCaptureMaskSets() {
-		auto &board1 = (player_to_move == PLAYER_1) ? board_1 : board_2;
-		auto &board2 = (player_to_move == PLAYER_1) ? board_2 : board_1;
-		vector<std::reference_wrapper<Board>> boards = {board1, board2};
-		vector<llint> available_four_in_a_rows;
+		const auto &own = (player_to_move == PLAYER_1) ? board_1 : board_2;
+		const auto &other = (player_to_move == PLAYER_1) ? board_2 : board_1;
 		vector<vector<llint>> capture_mask_sets;
+		FindCaptureSets(own.board, other.board, combined.board,
+		                [&](const GipfCaptures &set) {
+			                capture_mask_sets.emplace_back(set.begin(),
+			                                               set.end());
+		                });
+		return capture_mask_sets;
+	}
 
-		for (auto board : boards) {
-			for (auto row : four_in_a_row_cases) {
-				if (((~board.get().board) & row.first) == 0) {
-					llint capture_mask = 0;
-					auto direlt = row.second;
-					llint next;
-					if (next_element.at(direlt.first).find(direlt.second) != next_element.at(direlt.first).end()) {
-						next = next_element.at(direlt.first).at(direlt.second);
-					}
-					else {
-						next = 0;
-					}
-					bool matched = false;
-					while (combined.board & next or (!matched)) {
-						if (combined.board & next) {
-							capture_mask |= next;
-							matched = true;
-						}
-						if (next_element.at(direlt.first).find(next) != next_element.at(direlt.first).end()) {
-							next = next_element.at(direlt.first).at(next);
-						}
-						else {
-							next = 0;
-						}
-					}
-					available_four_in_a_rows.push_back(capture_mask);
+	static constexpr int max_capture_sets = MAX_CAPTURE_SETS;
+	// One row on the pushed line and 6 on each line crossing it; see
+	// MAX_CAPTURE_SETS.
+	static constexpr int max_capture_rows = 16;
+
+	// Calls `visit` with each alternative way of resolving the
+	// four-in-a-rows on the given boards, rows of `own` (the player who
+	// just pushed) first, and returns how many there are.
+	//
+	// A row is the four plus every piece extending it along its line. Rows
+	// sharing a cell exclude each other, so the choices are exactly the
+	// maximal sets of pairwise disjoint rows. Every set is reported; boards
+	// that break the bounds MAX_CAPTURE_SETS is derived from throw
+	// logic_error rather than lose any.
+	template <class Visit>
+	static int FindCaptureSets(ullint own, ullint other, ullint combined,
+	                           Visit &&visit) {
+		GIPF_PHASE(PHASE_CAPTURES);
+		static_assert(longest_line() < 8, "a line fits two rows");
+		llint rows[max_capture_rows];
+		int n_rows = 0;
+
+		for (auto board : {own, other}) {
+			for (auto axis : axes) {
+				llint ends = four_in_a_row_ends(board, axis);
+				while (ends) {
+					if (n_rows == max_capture_rows)
+						throw std::logic_error("More capture rows than a "
+						                       "legal position allows");
+					int bit = __builtin_ctzll(ends);
+					llint row = (1LL << bit) | run_from(bit, axis, combined) |
+					            run_from(bit, opposite(axis), combined);
+					rows[n_rows++] = row;
+					ends &= ~row;
 				}
 			}
 		}
-
-		for (auto row : available_four_in_a_rows) {
-			bool found_set = false;
-
-			for (auto& mask_set : capture_mask_sets) {
-				bool does_intersect = false;
-
-				for (auto mask : mask_set) {
-					if ((row & mask) != 0) {
-						does_intersect = true;
-						break;
-					}
-				}
-
-				if (!does_intersect) {
-					mask_set.push_back(row);
-					found_set = true;
-				}
-			}
-
-			if (!found_set) {
-				capture_mask_sets.push_back(vector<llint>(1, row));
+		if (n_rows == 0)
+			return 0;
+
+		uint32_t conflicts[max_capture_rows];
+		for (int i = 0; i < n_rows; i++) {
+			conflicts[i] = 0;
+			for (int j = 0; j < n_rows; j++) {
+				if (i != j && (rows[i] & rows[j]) != 0)
+					conflicts[i] |= 1u << j;
 			}
 		}
 
-		return capture_mask_sets;
+		int n_sets = 0;
+		auto count = [&](const GipfCaptures &set) {
+			if (++n_sets > max_capture_sets)
+				throw std::logic_error("More capture sets than a legal "
+				                       "position allows");
+			visit(set);
+		};
+		enumerate_capture_sets(rows, conflicts, (1u << n_rows) - 1, 0, 0,
+		                       count);
+		return n_sets;
 	}
 
-	void undo_move(const GipfMove &move) override {
-		auto prev_state = history.back();
-		history.pop_back();
-		board_1 = prev_state.board_1;
-		board_2 = prev_state.board_2;
-		combined = prev_state.combined;
-		pieces_left_1 = prev_state.pieces_left_1;
-		pieces_left_2 = prev_state.pieces_left_2;
-		player_to_move = prev_state.player_to_move;
+	// Restores the position saved by the last make_move, whatever the move.
+	void undo_move(const GipfMove &) override {
+		const auto &undo = history.pop();
+		static_cast<GipfPosition &>(*this) = undo.position;
+		player_to_move = undo.player_to_move;
+		assert(key == compute_key());
+		assert(eval == compute_eval());
+		assert(legal_pushes == legal_push_mask(combined.board));
 		return;
 	}
 
@@ -394,27 +446,8 @@ struct GipfState : public State<GipfState, GipfMove> {
 	}
 
 	ostream &to_stream(ostream &os) const override {
-		auto board_string_copy = board_string;
-		for (int i = 0; i < 9; i++) {
-			for (int j = 0; j < 9 - abs(i - 4); j++) {
-				int i_eff = 19 - abs(i - 4) - (j * 2);
-				int j_eff = i * 4 + 4;
-				if (board_1.get(i, j)) {
-					board_string_copy[i_eff][j_eff] = 'W';
-				} else if (board_2.get(i, j)) {
-					board_string_copy[i_eff][j_eff] = 'B';
-				}
-			}
-		}
-		os << " +-------------------------------------+ \n";
-		os << "         Pieces Left: B(" << pieces_left_2 << ") W("
-		   << pieces_left_1 << ")\n";
-		for (auto row : board_string_copy) {
-			os << row << std::endl;
-		}
-
-		os << player_to_move << endl;
-		return os;
+		write_position(os, board_1, board_2, pieces_left_1, pieces_left_2);
+		return os << player_to_move << endl;
 	}
 
 	bool operator==(const GipfState &other) const override {
@@ -422,15 +455,5 @@ struct GipfState : public State<GipfState, GipfMove> {
 		       player_to_move == other.player_to_move;
 	}
 
-	size_t hash() const override {
-		using boost::hash_combine;
-		using boost::hash_value;
-		size_t seed = 0;
-		hash_combine(seed, hash_value(board_1));
-		hash_combine(seed, hash_value(board_2));
-		hash_combine(seed, hash_value(pieces_left_1));
-		hash_combine(seed, hash_value(pieces_left_2));
-		hash_combine(seed, hash_value(player_to_move));
-		return seed;
-	}
+	size_t hash() const override { return key; }
 };
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "game_record.h"
+
+/**
+  Arena of search tree nodes in structure-of-arrays form.
+
+  Every node field lives in its own array. All arrays are carved out of one
+  allocation sized from a memory budget up front, so a search never touches
+  the heap and its footprint is fixed. The children of a node form one
+  contiguous block, referenced by the index of the first child and a count.
+  A node keeps its move as a PackedMove relative to its parent's position,
+  which makes a node 25 bytes.
+
+  Nodes are never freed one at a time. compact() keeps the subtree under one
+  node, collapses its least-visited subtrees and slides the survivors to
+  the front of the arena in a single pass. It serves both to advance the
+  root and to make room when the budget runs out.
+*/
+
+using NodeIndex = uint32_t;
+
+class NodePool {
+  public:
+	static constexpr NodeIndex ROOT = 0;
+	static constexpr size_t NODE_BYTES = sizeof(double) + sizeof(float) +
+	                                     sizeof(int32_t) + sizeof(NodeIndex) +
+	                                     sizeof(uint16_t) + sizeof(PackedMove) +
+	                                     sizeof(uint8_t);
+	// Fewest nodes a pool may hold: a root, its children and room to keep
+	// expanding after pruning everything below them.
+	static constexpr size_t MIN_NODES = 4 * MAX_MOVES;
+
+	explicit NodePool(size_t megabytes)
+	    : n_nodes(std::min<size_t>(megabytes * (1 << 20) / NODE_BYTES & ~7,
+	                               UINT32_MAX & ~7)),
+	      memory(static_cast<char *>(aligned_alloc(64, bytes_for(n_nodes))),
+	             &free) {
+		if (n_nodes < MIN_NODES)
+			throw invalid_argument("Node pool needs at least " +
+			                       to_string(MIN_NODES * NODE_BYTES) +
+			                       " bytes");
+		if (!memory)
+			throw std::bad_alloc();
+		// Widest fields first, so that every array stays aligned.
+		char *next = memory.get();
+		value_sum = carve<double>(next);
+		prior = carve<float>(next);
+		visits = carve<int32_t>(next);
+		first_child = carve<NodeIndex>(next);
+		n_children = carve<uint16_t>(next);
+		move = carve<PackedMove>(next);
+		expanded = carve<uint8_t>(next);
+		clear();
+	}
+
+	NodePool(const NodePool &) = delete;
+	NodePool &operator=(const NodePool &) = delete;
+
+	// Node fields, valid for indices below size().
+	double *value_sum;
+	float *prior;
+	int32_t *visits;
+	NodeIndex *first_child;
+	uint16_t *n_children;
+	PackedMove *move;
+	uint8_t *expanded;
+
+	size_t capacity() const { return n_nodes; }
+	size_t size() const { return used; }
+	size_t available() const { return n_nodes - used; }
+	size_t size_bytes() const { return bytes_for(n_nodes); }
+
+	// Empties the pool and allocates a fresh root.
+	void clear() {
+		used = 0;
+		allocate(1);
+	}
+
+	// Returns the first of `n` contiguous new nodes, all zeroed. The caller
+	// makes sure there is room.
+	NodeIndex allocate(int n) {
+		if (size_t(n) > available())
+			throw runtime_error("Node pool is full");
+		const NodeIndex first = used;
+		used += n;
+		std::fill(value_sum + first, value_sum + used, 0.0);
+		std::fill(prior + first, prior + used, 0.0f);
+		std::fill(visits + first, visits + used, 0);
+		std::fill(first_child + first, first_child + used, 0);
+		std::fill(n_children + first, n_children + used, 0);
+		std::fill(move + first, move + used, PackedMove{0, 0});
+		std::fill(expanded + first, expanded + used, 0);
+		return first;
+	}
+
+	// Makes `node` the root, dropping everything outside its subtree.
+	// Expanded nodes below it with fewer than `min_visits` visits lose
+	// their children and are expanded again if search comes back to them.
+	void compact(NodeIndex node, int min_visits = 0) {
+		blocks.clear();
+		pending.assign(1, node);
+		while (!pending.empty()) {
+			const NodeIndex parent = pending.back();
+			pending.pop_back();
+			if (n_children[parent] == 0)
+				continue;
+			if (parent != node && visits[parent] < min_visits) {
+				n_children[parent] = 0;
+				expanded[parent] = 0;
+				continue;
+			}
+			blocks.push_back(
+			    Block{first_child[parent], n_children[parent], 0});
+			for (int i = 0; i < n_children[parent]; i++)
+				pending.push_back(first_child[parent] + i);
+		}
+
+		// Sliding blocks to the front in address order never overwrites a
+		// node still to move.
+		std::sort(blocks.begin(), blocks.end());
+		NodeIndex to = 1;
+		for (auto &block : blocks) {
+			block.to = to;
+			to += block.count;
+		}
+
+		const NodeIndex root_child = first_child[node];
+		const uint16_t root_children = n_children[node];
+		copy(node, ROOT);
+		if (root_children > 0)
+			first_child[ROOT] = relocated(root_child);
+		for (const auto &block : blocks) {
+			for (NodeIndex i = 0; i < block.count; i++) {
+				copy(block.from + i, block.to + i);
+				if (n_children[block.to + i] > 0)
+					first_child[block.to + i] =
+					    relocated(first_child[block.to + i]);
+			}
+		}
+		move[ROOT] = PackedMove{0, 0};
+		prior[ROOT] = 1;
+		used = to;
+	}
+
+  private:
+	struct Block {
+		NodeIndex from, count, to;
+
+		bool operator<(const Block &other) const { return from < other.from; }
+	};
+
+	// Rounded up to the alignment, as aligned_alloc requires.
+	static size_t bytes_for(size_t nodes) {
+		return (nodes * NODE_BYTES + 63) & ~size_t(63);
+	}
+
+	template <class T>
+	T *carve(char *&next) {
+		T *array = reinterpret_cast<T *>(next);
+		next += n_nodes * sizeof(T);
+		return array;
+	}
+
+	void copy(NodeIndex from, NodeIndex to) {
+		value_sum[to] = value_sum[from];
+		prior[to] = prior[from];
+		visits[to] = visits[from];
+		first_child[to] = first_child[from];
+		n_children[to] = n_children[from];
+		move[to] = move[from];
+		expanded[to] = expanded[from];
+	}
+
+	NodeIndex relocated(NodeIndex from) const {
+		return std::lower_bound(blocks.begin(), blocks.end(), Block{from, 0, 0})
+		    ->to;
+	}
+
+	const size_t n_nodes;
+	std::unique_ptr<char, decltype(&free)> memory;
+	size_t used = 0;
+	// Scratch space for compact(), kept to avoid reallocating.
+	vector<Block> blocks;
+	vector<NodeIndex> pending;
+};
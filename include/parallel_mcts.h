@@ -0,0 +1,244 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "gipf.h"
+#include "playout.h"
+#include "search_stats.h"
+
+/**
+  Tree-parallel Monte Carlo tree search for Gipf.
+
+  All threads share one tree. A thread walking down the tree adds
+  `virtual_loss` visits to every node it passes. These count as losses until
+  the playout result arrives, so concurrent threads spread out over
+  different lines. Node statistics are atomics, and expanding a node takes
+  that node's mutex only.
+*/
+
+struct ParallelMCTSNode {
+	GipfMove move;
+	ParallelMCTSNode *parent = nullptr;
+	// The player who made `move`; results are counted for them.
+	char player = EMPTY;
+
+	std::atomic<int> visits{0};
+	// Playout results in half points for `player`: 2 per win, 1 per draw.
+	std::atomic<long long> score{0};
+
+	std::atomic<bool> expanded{false};
+	std::mutex expand_mutex;
+	std::unique_ptr<ParallelMCTSNode[]> children;
+	int n_children = 0;
+};
+
+struct ParallelMCTSStats {
+	int simulations = 0;
+	double seconds = 0;
+	int threads = 0;
+	// Average playout score of the chosen move for the player to move.
+	double value = 0;
+
+	double simulations_per_second() const {
+		return seconds > 0 ? simulations / seconds : 0;
+	}
+};
+
+struct ParallelMCTS : public Algorithm<GipfState, GipfMove> {
+	const double max_seconds;
+	const int max_simulations;
+	const int threads;
+	const double exploration;
+	const int virtual_loss;
+	// Playouts longer than this are scored as draws.
+	const int max_playout_plies;
+
+	ParallelMCTSStats last_search;
+	// Statistics of the last search, filled in builds with GIPF_INSTRUMENT.
+	SearchStats last_stats;
+
+	ParallelMCTS(double max_seconds = 1, int max_simulations = INF,
+	             int threads = std::thread::hardware_concurrency(),
+	             double exploration = std::sqrt(2.0), int virtual_loss = 3,
+	             int max_playout_plies = 1000, unsigned long long seed = 0)
+	    : max_seconds(max_seconds), max_simulations(max_simulations),
+	      threads(std::max(threads, 1)), exploration(exploration),
+	      virtual_loss(std::max(virtual_loss, 1)),
+	      max_playout_plies(max_playout_plies), seed(seed) {}
+
+	// `log` is not owned; null stops logging.
+	void set_stats_log(SearchStatsLog *log) { stats_log = log; }
+
+	GipfMove get_move(GipfState *state) override {
+		ParallelMCTSNode root;
+		root.player = state->get_enemy(state->player_to_move);
+		// Expanded up front so that the root has children even if no
+		// simulation runs; it has none only if there are no moves.
+		expand(root, *state);
+
+		std::atomic<int> simulations{0};
+		const auto start = std::chrono::steady_clock::now();
+		const auto deadline =
+		    start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+		                std::chrono::duration<double>(max_seconds));
+		const unsigned long long search_seed = seed + searches++;
+#ifdef GIPF_INSTRUMENT
+		vector<SearchStats> thread_stats(threads);
+#endif
+
+		auto worker = [&](int thread_id) {
+			GIPF_STATS_SCOPE(thread_stats[thread_id]);
+			std::mt19937_64 rng(search_seed * 1000003 + thread_id);
+			while (std::chrono::steady_clock::now() < deadline &&
+			       simulations.fetch_add(1) < max_simulations) {
+				simulate(*state, root, rng);
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (int i = 1; i < threads; i++) {
+			pool.emplace_back(worker, i);
+		}
+		worker(0);
+		for (auto &thread : pool) {
+			thread.join();
+		}
+
+		last_search.simulations =
+		    std::min(simulations.load(), max_simulations);
+		last_search.seconds = std::chrono::duration<double>(
+		                          std::chrono::steady_clock::now() - start)
+		                          .count();
+		last_search.threads = threads;
+
+		const ParallelMCTSNode *best = best_child(root);
+		if (!best)
+			throw runtime_error("No legal moves to search");
+		last_search.value =
+		    best->visits > 0 ? best->score / (2.0 * best->visits) : 0;
+
+#ifdef GIPF_INSTRUMENT
+		last_stats = SearchStats();
+		last_stats.algorithm = get_name();
+		last_stats.move = searches - 1;
+		last_stats.threads = threads;
+		last_stats.seconds = last_search.seconds;
+		for (const auto &stats : thread_stats)
+			last_stats.merge(stats);
+		last_stats.depth = last_stats.max_depth;
+		if (stats_log)
+			stats_log->write(last_stats);
+#endif
+		return best->move;
+	}
+
+	string get_name() const override { return "ParallelMCTS"; }
+
+  private:
+	const unsigned long long seed;
+	unsigned long long searches = 0;
+	SearchStatsLog *stats_log = nullptr;
+
+	void simulate(const GipfState &root_state, ParallelMCTSNode &root,
+	              std::mt19937_64 &rng) {
+		GipfState state = root_state.clone();
+		ParallelMCTSNode *node = &root;
+		node->visits += virtual_loss;
+
+		int depth = 0;
+		while (true) {
+			if (!node->expanded.load(std::memory_order_acquire)) {
+				expand(*node, state);
+			}
+			if (node->n_children == 0) {
+				break;
+			}
+			ParallelMCTSNode *child = select_child(*node);
+			const bool first_visit =
+			    child->visits.fetch_add(virtual_loss) == 0;
+			state.apply_move(child->move);
+			node = child;
+			depth++;
+			if (first_visit) {
+				break;
+			}
+		}
+		GIPF_STATS(stats_node(depth));
+
+		const char winner = playout(state, rng);
+		for (; node != nullptr; node = node->parent) {
+			node->visits -= virtual_loss - 1;
+			if (winner == node->player) {
+				node->score += 2;
+			} else if (winner == EMPTY) {
+				node->score += 1;
+			}
+		}
+	}
+
+	void expand(ParallelMCTSNode &node, const GipfState &state) {
+		std::lock_guard<std::mutex> lock(node.expand_mutex);
+		if (node.expanded.load(std::memory_order_relaxed)) {
+			return;
+		}
+		if (!state.is_terminal()) {
+			GipfMoveList moves;
+			state.generate_moves(moves);
+			GIPF_STATS(stats_expansion(moves.size()));
+			node.children.reset(new ParallelMCTSNode[moves.size()]);
+			for (int i = 0; i < moves.size(); i++) {
+				node.children[i].move = moves[i];
+				node.children[i].parent = &node;
+				node.children[i].player = state.player_to_move;
+			}
+			node.n_children = moves.size();
+		}
+		node.expanded.store(true, std::memory_order_release);
+	}
+
+	// Only called on nodes with children.
+	ParallelMCTSNode *select_child(ParallelMCTSNode &node) const {
+		const double log_visits =
+		    std::log(std::max(node.visits.load(std::memory_order_relaxed), 1));
+		ParallelMCTSNode *best = &node.children[0];
+		double best_value = -1;
+		for (int i = 0; i < node.n_children; i++) {
+			ParallelMCTSNode &child = node.children[i];
+			const int visits = child.visits.load(std::memory_order_relaxed);
+			if (visits == 0) {
+				return &child;
+			}
+			const double value =
+			    child.score.load(std::memory_order_relaxed) / (2.0 * visits) +
+			    exploration * std::sqrt(log_visits / visits);
+			if (value > best_value) {
+				best_value = value;
+				best = &child;
+			}
+		}
+		return best;
+	}
+
+	// Plays random pushes to the end of the game and returns the winner,
+	// or EMPTY for a draw.
+	char playout(const GipfState &state, std::mt19937_64 &rng) const {
+		GIPF_PHASE(PHASE_EVAL);
+		return random_playout(state, rng, max_playout_plies).winner;
+	}
+
+	const ParallelMCTSNode *best_child(const ParallelMCTSNode &root) const {
+		const ParallelMCTSNode *best = nullptr;
+		for (int i = 0; i < root.n_children; i++) {
+			if (!best || root.children[i].visits > best->visits) {
+				best = &root.children[i];
+			}
+		}
+		return best;
+	}
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "gipf.h"
+
+/**
+  Random playouts that never build a move list.
+
+  Each ply picks a push uniformly at random from a mask of legal pushes,
+  kept up to date from the cells each ply fills and empties. The
+  four-in-a-rows a push forms are resolved with the first capture choice
+  generate_moves would list for it: rows of the player who pushed first,
+  each taken unless it shares a cell with one taken before.
+
+  The game is played out on plain bitboards held on the stack. Nothing is
+  cloned, no capture sets are enumerated and the heap is never touched.
+*/
+
+struct PlayoutResult {
+	// PLAYER_1 or PLAYER_2, or EMPTY if the playout ran out of plies or of
+	// legal pushes.
+	char winner;
+	int plies;
+};
+
+// Applies the first capture choice after player `side` (0 or 1) pushed,
+// returning captured pieces to reserves as GipfState::ResolveRow does.
+inline void resolve_first_captures(ullint boards[2], int pieces_left[2],
+                                   int side) {
+	const ullint combined = boards[0] | boards[1];
+	const ullint scanned[2] = {boards[side], boards[1 - side]};
+	ullint taken = 0;
+	int n_rows = 0;
+	for (auto board : scanned) {
+		for (auto axis : axes) {
+			llint ends = four_in_a_row_ends(board, axis);
+			while (ends && n_rows < GipfState::max_capture_rows) {
+				const int bit = __builtin_ctzll(ends);
+				const llint row = (1LL << bit) |
+				                  run_from(bit, axis, combined) |
+				                  run_from(bit, opposite(axis), combined);
+				n_rows++;
+				ends &= ~row;
+				if (row & taken)
+					continue;
+				taken |= row;
+
+				const int count_1 = __builtin_popcountll(boards[0] & row);
+				const int count_2 = __builtin_popcountll(boards[1] & row);
+				if (count_2 >= 4) {
+					pieces_left[1] += count_2;
+				} else {
+					pieces_left[0] += count_1;
+				}
+			}
+		}
+	}
+	boards[0] &= ~taken;
+	boards[1] &= ~taken;
+}
+
+// Plays random pushes from `state` until the game ends or `max_plies` have
+// been played. `rng` is any generator returning 64-bit values.
+template <class RNG>
+PlayoutResult random_playout(const GipfState &state, RNG &rng,
+                             int max_plies = 1000) {
+	ullint boards[2] = {state.board_1.board, state.board_2.board};
+	int pieces_left[2] = {state.pieces_left_1, state.pieces_left_2};
+	int side = (state.player_to_move == PLAYER_1) ? 0 : 1;
+	uint64_t legal = state.legal_pushes;
+	int plies = 0;
+	while (pieces_left[0] > 0 && pieces_left[1] > 0 && plies < max_plies) {
+		if (!legal)
+			break;
+		uint64_t pick = legal;
+		for (int k = rng() % __builtin_popcountll(legal); k > 0; k--)
+			pick &= pick - 1;
+		const Push &push = entry_pushes[__builtin_ctzll(pick)];
+		const ullint combined = boards[0] | boards[1];
+
+		Board own, all;
+		own.board = boards[side];
+		all.board = combined;
+		own.SlidePieces(push.elt, push.dir, all);
+		boards[side] = own.board;
+		boards[1 - side] = all.board & ~own.board;
+		pieces_left[side]--;
+		resolve_first_captures(boards, pieces_left, side);
+		legal = update_legal_pushes(legal, combined, boards[0] | boards[1]);
+
+		side ^= 1;
+		plies++;
+	}
+
+	char winner = EMPTY;
+	if (pieces_left[1] <= 0) {
+		winner = PLAYER_1;
+	} else if (pieces_left[0] <= 0) {
+		winner = PLAYER_2;
+	}
+	return PlayoutResult{winner, plies};
+}
@@ -0,0 +1,491 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "gipf.h"
+#include "node_pool.h"
+#include "parallel_mcts.h"
+#include "playout.h"
+#include "search_stats.h"
+#include "transposition_table.h"
+
+/**
+  PUCT Monte Carlo tree search for Gipf, as in AlphaZero.
+
+  Children are picked by Q + c_puct * P * sqrt(N_parent) / (1 + N). P is the
+  prior of a move and Q is its mean value for the player making it. Leaves
+  are scored by a PUCTEvaluator. The default evaluator uses uniform priors
+  and a random rollout. Priors, a value network or both can be supplied by
+  subclassing it, from Python too (see gipf.i).
+
+  The tree persists between searches. A search from a position one or two
+  plies below the old root, i.e. after our move and the opponent's reply,
+  continues from that subtree. Any other position starts a new tree.
+
+  With pondering on, the search re-roots at the move it returned and keeps
+  simulating on a background thread until the next call arrives. The
+  opponent's thinking time then grows the subtree the next search starts
+  from. Each public call stops the ponder thread before touching the tree,
+  except the read-only ones below that it never writes. An error while
+  pondering ends it and is rethrown by the next get_move.
+
+  Nodes live in a NodePool of fixed size. When it runs low, the least
+  visited subtrees are pruned, and advancing the root compacts the kept
+  subtree in place, so memory use per search is bounded and predictable.
+
+  With a TranspositionTable, leaf values are pooled per position: a leaf
+  scores the running mean of every evaluation of its position, whatever
+  the path, tree or thread that reached it. This lowers the variance of
+  rollout values and can be shared by concurrent searches.
+*/
+
+struct PUCTEvaluator {
+	explicit PUCTEvaluator(unsigned long long seed = 0) : rng(seed) {}
+	virtual ~PUCTEvaluator() {}
+
+	// Prior probabilities of `moves`, in the same order.
+	virtual vector<float> priors(const GipfState &state,
+	                             const vector<GipfMove> &moves) {
+		return vector<float>(moves.size(), 1.0f / moves.size());
+	}
+
+	// Value of a non-terminal `state` for the player to move, in [-1, 1].
+	virtual float value(const GipfState &state) {
+		const char winner =
+		    random_playout(state, rng, max_playout_plies).winner;
+		if (winner == EMPTY)
+			return 0;
+		return winner == state.player_to_move ? 1 : -1;
+	}
+
+	// Fills `priors` for `moves` and returns the value of `state`. Searches
+	// call this once per leaf; override it to evaluate both at once.
+	virtual float evaluate(const GipfState &state,
+	                       const vector<GipfMove> &moves,
+	                       vector<float> &priors) {
+		priors = this->priors(state, moves);
+		return value(state);
+	}
+
+	// Rollouts longer than this are scored as draws.
+	int max_playout_plies = 1000;
+
+  private:
+	std::mt19937_64 rng;
+};
+
+struct PUCTMCTS : public Algorithm<GipfState, GipfMove> {
+	double c_puct;
+	double max_seconds;
+	int max_simulations;
+
+	ParallelMCTSStats last_search;
+	// Simulations run while pondering before the last search.
+	int last_ponder_simulations = 0;
+	// Pondering stops by itself after this many simulations.
+	int max_ponder_simulations = 1 << 20;
+	// Times the tree was pruned to stay within its memory budget.
+	long long tree_prunes = 0;
+	// Statistics of the last search, filled in builds with GIPF_INSTRUMENT.
+	// Simulations run while pondering are not counted.
+	SearchStats last_stats;
+
+	// `evaluator` is not owned and must outlive the search; null selects the
+	// built-in uniform-prior rollout evaluator. The tree never grows beyond
+	// `tree_megabytes`.
+	PUCTMCTS(double c_puct = 5, double max_seconds = 1,
+	         int max_simulations = INF, PUCTEvaluator *evaluator = nullptr,
+	         unsigned long long seed = 0, size_t tree_megabytes = 64)
+	    : c_puct(c_puct), max_seconds(max_seconds),
+	      max_simulations(max_simulations), default_evaluator(seed),
+	      evaluator(evaluator ? evaluator : &default_evaluator),
+	      pool(tree_megabytes), tree_size(pool.size()) {}
+
+	PUCTMCTS(const PUCTMCTS &) = delete;
+	PUCTMCTS &operator=(const PUCTMCTS &) = delete;
+
+	~PUCTMCTS() { stop_pondering(); }
+
+	// `table` is not owned; null disables it.
+	void set_table(TranspositionTable *new_table) {
+		stop_pondering();
+		table = new_table;
+	}
+
+	void set_evaluator(PUCTEvaluator *new_evaluator) {
+		evaluator = new_evaluator ? new_evaluator : &default_evaluator;
+		reset();
+	}
+
+	// `log` is not owned; null stops logging.
+	void set_stats_log(SearchStatsLog *log) {
+		stop_pondering();
+		stats_log = log;
+	}
+
+	// The evaluator is called from the ponder thread too, so it must be
+	// safe to use from another thread.
+	void set_pondering(bool enabled) {
+		stop_pondering();
+		pondering = enabled;
+	}
+
+	GipfMove get_move(GipfState *state) override {
+		return get_move(state, max_seconds, max_simulations);
+	}
+
+	// Searches for `seconds` or `simulations` playouts, whichever runs out
+	// first, and returns the most visited move.
+	GipfMove get_move(GipfState *state, double seconds,
+	                  int simulations = INF) {
+		last_ponder_simulations = stop_pondering();
+		if (ponder_error) {
+			const std::exception_ptr error = ponder_error;
+			ponder_error = nullptr;
+			std::rethrow_exception(error);
+		}
+		if (!advance_to(*state))
+			start_tree(*state);
+
+		int done = 0;
+		const auto start = std::chrono::steady_clock::now();
+		const auto deadline =
+		    start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+		                std::chrono::duration<double>(seconds));
+		GIPF_STATS(last_stats = SearchStats());
+		{
+			GIPF_STATS_SCOPE(last_stats);
+			do {
+				simulate(*state);
+				done++;
+			} while (done < simulations &&
+			         std::chrono::steady_clock::now() < deadline);
+		}
+
+		last_search.simulations = done;
+		last_search.seconds = std::chrono::duration<double>(
+		                          std::chrono::steady_clock::now() - start)
+		                          .count();
+		last_search.threads = 1;
+
+		const NodeIndex first = pool.first_child[NodePool::ROOT];
+		const int n = pool.n_children[NodePool::ROOT];
+		if (n == 0)
+			throw runtime_error("No legal moves to search");
+		NodeIndex best = first;
+		int total = 0;
+		for (NodeIndex child = first; child < first + n; child++) {
+			if (pool.visits[child] > pool.visits[best])
+				best = child;
+			total += pool.visits[child];
+		}
+		last_search.value = (q(best) + 1) / 2;
+
+#ifdef GIPF_INSTRUMENT
+		last_stats.algorithm = get_name();
+		last_stats.move = searches;
+		last_stats.seconds = last_search.seconds;
+		last_stats.depth = last_stats.max_depth;
+		if (stats_log)
+			stats_log->write(last_stats);
+#endif
+		searches++;
+
+		searched_moves.clear();
+		visit_shares.clear();
+		for (NodeIndex child = first; child < first + n; child++) {
+			searched_moves.push_back(unpack_move(root_state, pool.move[child]));
+			visit_shares.push_back(
+			    total ? float(pool.visits[child]) / total : 0);
+		}
+
+		const GipfMove move = searched_moves[best - first];
+		if (pondering) {
+			update_with_move(move);
+			start_pondering();
+		}
+		return move;
+	}
+
+	// The root moves of the last search and their share of its visits, in
+	// the same order. Only get_move writes them, so they may be read while
+	// pondering.
+	vector<GipfMove> root_moves() const { return searched_moves; }
+	vector<float> root_visit_shares() const { return visit_shares; }
+
+	// Moves the root to the child reached by `move`, keeping its subtree.
+	// Forgets the tree if the move was not expanded.
+	void update_with_move(const GipfMove &move) {
+		stop_pondering();
+		if (root_valid) {
+			const NodeIndex first = pool.first_child[NodePool::ROOT];
+			for (int i = 0; i < pool.n_children[NodePool::ROOT]; i++) {
+				if (unpack_move(root_state, pool.move[first + i]) == move) {
+					GipfState next = root_state;
+					next.apply_move(move);
+					reroot(first + i, next);
+					return;
+				}
+			}
+		}
+		reset();
+	}
+
+	void reset() override {
+		stop_pondering();
+		pool.clear();
+		tree_size.store(pool.size(), std::memory_order_relaxed);
+		root_valid = false;
+	}
+
+	// Nodes in the tree and the most it can hold. The count is the one
+	// after the latest simulation, so it may be read while pondering.
+	size_t tree_nodes() const {
+		return tree_size.load(std::memory_order_relaxed);
+	}
+	size_t tree_capacity() const { return pool.capacity(); }
+
+	string get_name() const override { return "PUCTMCTS"; }
+
+  private:
+	PUCTEvaluator default_evaluator;
+	PUCTEvaluator *evaluator;
+	TranspositionTable *table = nullptr;
+	SearchStatsLog *stats_log = nullptr;
+	int searches = 0;
+
+	NodePool pool;
+	GipfState root_state;
+	uint64_t root_key = 0;
+	bool root_valid = false;
+	vector<NodeIndex> path;
+	vector<GipfMove> searched_moves;
+	vector<float> visit_shares;
+
+	// pool.size(), published for tree_nodes.
+	std::atomic<size_t> tree_size;
+
+	bool pondering = false;
+	std::thread ponder_thread;
+	std::atomic<bool> ponder_stop{false};
+	int ponder_simulations = 0;
+	std::exception_ptr ponder_error;
+
+	double q(NodeIndex node) const {
+		return pool.visits[node] > 0 ? pool.value_sum[node] / pool.visits[node]
+		                             : 0;
+	}
+
+	void start_tree(const GipfState &state) {
+		pool.clear();
+		tree_size.store(pool.size(), std::memory_order_relaxed);
+		root_state = state.clone();
+		root_key = state.key;
+		root_valid = true;
+	}
+
+	static bool same_position(const GipfState &a, const GipfState &b) {
+		return a.key == b.key && a.player_to_move == b.player_to_move;
+	}
+
+	// Makes `node`, reached in position `state`, the root.
+	void reroot(NodeIndex node, const GipfState &state) {
+		pool.compact(node);
+		tree_size.store(pool.size(), std::memory_order_relaxed);
+		root_state = state;
+		root_key = state.key;
+	}
+
+	// Re-roots at `state` if it is the root or one or two plies below it.
+	bool advance_to(const GipfState &state) {
+		if (!root_valid)
+			return false;
+		if (same_position(root_state, state))
+			return true;
+		const NodeIndex first = pool.first_child[NodePool::ROOT];
+		for (int i = 0; i < pool.n_children[NodePool::ROOT]; i++) {
+			const NodeIndex child = first + i;
+			GipfState after = root_state;
+			after.apply_move(unpack_move(root_state, pool.move[child]));
+			if (same_position(after, state)) {
+				reroot(child, after);
+				return true;
+			}
+			const NodeIndex replies = pool.first_child[child];
+			for (int j = 0; j < pool.n_children[child]; j++) {
+				GipfState reply = after;
+				reply.apply_move(unpack_move(after, pool.move[replies + j]));
+				if (same_position(reply, state)) {
+					reroot(replies + j, reply);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void start_pondering() {
+		if (!root_valid || root_state.is_terminal())
+			return;
+		ponder_stop = false;
+		ponder_simulations = 0;
+		ponder_thread = std::thread([this]() {
+			try {
+				while (!ponder_stop.load(std::memory_order_relaxed) &&
+				       ponder_simulations < max_ponder_simulations) {
+					simulate(root_state);
+					ponder_simulations++;
+				}
+			} catch (...) {
+				ponder_error = std::current_exception();
+			}
+		});
+	}
+
+	// Stops the ponder thread, if running, and returns how many
+	// simulations it ran.
+	int stop_pondering() {
+		if (!ponder_thread.joinable())
+			return 0;
+		ponder_stop = true;
+		ponder_thread.join();
+		return ponder_simulations;
+	}
+
+	void simulate(const GipfState &root_position) {
+		if (pool.available() < size_t(MAX_MOVES))
+			prune();
+
+		GipfState state = root_position.clone();
+		NodeIndex node = NodePool::ROOT;
+		path.clear();
+		path.push_back(node);
+		while (pool.expanded[node] && pool.n_children[node] > 0) {
+			node = select_child(node);
+			state.apply_move(unpack_move(state, pool.move[node]));
+			path.push_back(node);
+		}
+		GIPF_STATS(stats_node(int(path.size()) - 1));
+
+		// Value for the player to move in `state`.
+		float value;
+		if (state.is_terminal()) {
+			value = terminal_value(state);
+		} else {
+			value = expand(node, state);
+		}
+
+		for (auto it = path.rbegin(); it != path.rend(); ++it) {
+			value = -value;
+			pool.visits[*it]++;
+			pool.value_sum[*it] += value;
+		}
+		tree_size.store(pool.size(), std::memory_order_relaxed);
+	}
+
+	// Collapses ever more visited subtrees until the tree fills at most
+	// half of its pool.
+	void prune() {
+		for (int min_visits = 2;; min_visits *= 2) {
+			pool.compact(NodePool::ROOT, min_visits);
+			// Past the root's visits only the root's children are left.
+			if (pool.size() <= pool.capacity() / 2 ||
+			    min_visits > pool.visits[NodePool::ROOT])
+				break;
+		}
+		tree_prunes++;
+	}
+
+	// Adds the children of `node` and returns the value of `state` for the
+	// player to move.
+	float expand(NodeIndex node, const GipfState &state) {
+		GipfMoveList list;
+		state.generate_moves(list);
+		if (list.empty()) {
+			pool.expanded[node] = 1;
+			return 0;
+		}
+
+		GIPF_STATS(stats_expansion(list.size()));
+
+		vector<GipfMove> moves(list.begin(), list.end());
+		vector<float> priors;
+		float value;
+		{
+			GIPF_PHASE(PHASE_EVAL);
+			value = evaluator->evaluate(state, moves, priors);
+		}
+		if (priors.size() != moves.size())
+			throw invalid_argument("Evaluator returned " +
+			                       to_string(priors.size()) + " priors for " +
+			                       to_string(moves.size()) + " moves");
+
+		// generate_moves lists the capture choices of a push in the order
+		// pack_move numbers them, so they are packed without regenerating
+		// the capture sets.
+		const NodeIndex first = pool.allocate(moves.size());
+		PackedMove previous{TT_NO_MOVE, 0};
+		for (size_t i = 0; i < moves.size(); i++) {
+			PackedMove packed{uint8_t(push_index(moves[i].elt, moves[i].dir)),
+			                  0};
+			if (!moves[i].captures.empty())
+				packed.choice =
+				    packed.push == previous.push ? previous.choice + 1 : 1;
+			pool.move[first + i] = previous = packed;
+			pool.prior[first + i] = priors[i];
+		}
+		pool.first_child[node] = first;
+		pool.n_children[node] = moves.size();
+		pool.expanded[node] = 1;
+		return table ? pooled_value(state.key, value) : value;
+	}
+
+	// Folds `value` into the table's mean for this position and returns it.
+	float pooled_value(uint64_t key, float value) {
+		TTValue entry;
+		const bool hit = table->probe(key, entry);
+		GIPF_STATS(stats_probe(hit));
+		if (hit) {
+			const float mean = float(entry.value) / TT_VALUE_SCALE;
+			value = entry.visits < TT_MAX_VISITS
+			            ? (mean * entry.visits + value) / (entry.visits + 1)
+			            : mean;
+		}
+		entry.value = int32_t(value * TT_VALUE_SCALE);
+		entry.visits++;
+		table->store(key, entry);
+		return value;
+	}
+
+	NodeIndex select_child(NodeIndex node) const {
+		const double scale = c_puct * std::sqrt(double(pool.visits[node]));
+		const NodeIndex first = pool.first_child[node];
+		NodeIndex best = first;
+		double best_value = -INFINITY;
+		for (NodeIndex child = first; child < first + pool.n_children[node];
+		     child++) {
+			const double value =
+			    q(child) + scale * pool.prior[child] / (1 + pool.visits[child]);
+			if (value > best_value) {
+				best_value = value;
+				best = child;
+			}
+		}
+		return best;
+	}
+
+	static float terminal_value(const GipfState &state) {
+		if (state.is_winner(state.player_to_move)) {
+			return 1;
+		} else if (state.is_winner(state.get_enemy(state.player_to_move))) {
+			return -1;
+		}
+		return 0;
+	}
+};
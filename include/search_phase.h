@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+
+#if !defined(__x86_64__) && !defined(__i386__)
+#include <chrono>
+#endif
+
+/**
+  Search phase timing, the part of the instrumentation in search_stats.h
+  that the engine itself uses. Kept apart so that gipf.h only pulls in
+  GIPF_PHASE and what it needs.
+
+  The phases are timed by switching: entering a phase charges the time
+  since the last switch to the phase being left. Nested phases are
+  therefore charged exclusively and the phases add up to the search time.
+  Ticks come from the time stamp counter where there is one.
+*/
+
+enum SearchPhase {
+	PHASE_MOVEGEN,
+	PHASE_CAPTURES,
+	PHASE_EVAL,
+	PHASE_TREE,
+	// Never entered; holds the estimated cost of the switches.
+	PHASE_OVERHEAD,
+	SEARCH_PHASES
+};
+
+inline uint64_t search_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Ticks spent in each phase and the switches into it since the last reset.
+struct PhaseClock {
+	uint64_t ticks[SEARCH_PHASES] = {};
+	uint64_t switches[SEARCH_PHASES] = {};
+	SearchPhase phase = PHASE_TREE;
+	uint64_t last_tick = 0;
+
+	// Charges the time since the last switch to the current phase, enters
+	// `next` and returns the phase left.
+	SearchPhase switch_phase(SearchPhase next) {
+		const uint64_t now = search_ticks();
+		ticks[phase] += now - last_tick;
+		last_tick = now;
+		const SearchPhase left = phase;
+		phase = next;
+		switches[next]++;
+		return left;
+	}
+};
+
+// The PhaseClock this thread times into, or null.
+inline PhaseClock *&active_phase_clock() {
+	static thread_local PhaseClock *active = nullptr;
+	return active;
+}
+
+// Charges the time until the end of the enclosing block to `phase`.
+class PhaseScope {
+  public:
+	explicit PhaseScope(SearchPhase phase) : clock(active_phase_clock()) {
+		if (clock)
+			left = clock->switch_phase(phase);
+	}
+
+	PhaseScope(const PhaseScope &) = delete;
+	PhaseScope &operator=(const PhaseScope &) = delete;
+
+	~PhaseScope() {
+		if (clock)
+			clock->switch_phase(left);
+	}
+
+  private:
+	PhaseClock *const clock;
+	SearchPhase left = PHASE_TREE;
+};
+
+#define GIPF_STATS_CONCAT_(a, b) a##b
+#define GIPF_STATS_CONCAT(a, b) GIPF_STATS_CONCAT_(a, b)
+
+#ifdef GIPF_INSTRUMENT
+// Times the rest of the enclosing block as `phase`.
+#define GIPF_PHASE(phase) \
+	PhaseScope GIPF_STATS_CONCAT(phase_scope_, __LINE__)(phase)
+#else
+#define GIPF_PHASE(phase) ((void)0)
+#endif
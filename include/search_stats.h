@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "search_phase.h"
+
+/**
+  Optional per-move search instrumentation.
+
+  In builds with GIPF_INSTRUMENT defined (cmake -DGIPF_INSTRUMENT=ON), each
+  search fills a SearchStats. It counts nodes, their depths, the moves
+  generated at expanded nodes and transposition table hits. It also splits
+  the search time into phases:
+   - move generation,
+   - capture detection,
+   - evaluation, which for MCTS includes rollouts,
+   - tree bookkeeping, which is everything else.
+  A SearchStatsLog writes each move's statistics as one JSON line. Without
+  GIPF_INSTRUMENT the recording macros expand to nothing, so searches run
+  exactly as before and last_stats stays empty.
+
+  The phases are timed as described in search_phase.h, and the ticks are
+  turned into seconds against the wall clock over the whole search. A
+  switch costs about as much as a small phase, so the cost of each one,
+  measured once per process, is taken out of the phase it entered and
+  reported as PHASE_OVERHEAD instead.
+
+  Statistics go to the SearchStats that the current thread activated with
+  a SearchStatsScope, so each search thread records into its own.
+*/
+
+constexpr bool instrumentation_enabled() {
+#ifdef GIPF_INSTRUMENT
+	return true;
+#else
+	return false;
+#endif
+}
+
+struct SearchStats {
+	std::string algorithm;
+	// Searches made by the algorithm before this one.
+	int move = 0;
+	int threads = 1;
+	double seconds = 0;
+	// Alpha-beta: every node including quiescence. MCTS: simulations.
+	long long nodes = 0;
+	// Deepest completed iteration, or the deepest leaf for MCTS.
+	int depth = 0;
+	int max_depth = 0;
+	long long depth_sum = 0;
+	// Nodes whose moves were generated, and how many moves they had.
+	long long expanded = 0;
+	long long children = 0;
+	long long table_probes = 0;
+	long long table_hits = 0;
+	// Summed over threads.
+	double phase_seconds[SEARCH_PHASES] = {};
+
+	double nodes_per_second() const {
+		return seconds > 0 ? nodes / seconds : 0;
+	}
+
+	double average_depth() const {
+		return nodes ? double(depth_sum) / nodes : 0;
+	}
+
+	double table_hit_rate() const {
+		return table_probes ? double(table_hits) / table_probes : 0;
+	}
+
+	// The b for which a uniform tree of `depth` plies, b + b^2 + ... +
+	// b^depth nodes, would have as many expanded nodes as this search.
+	double effective_branching_factor() const {
+		if (depth <= 0 || expanded <= 0)
+			return 0;
+		double low = 0, high = double(expanded);
+		for (int i = 0; i < 64; i++) {
+			const double b = (low + high) / 2;
+			double total = 0, power = 1;
+			for (int k = 0; k < depth && total < expanded; k++) {
+				power *= b;
+				total += power;
+			}
+			(total < expanded ? low : high) = b;
+		}
+		return (low + high) / 2;
+	}
+
+	void record_node(int node_depth) {
+		nodes++;
+		depth_sum += node_depth;
+		max_depth = std::max(max_depth, node_depth);
+	}
+
+	void record_expansion(int moves) {
+		expanded++;
+		children += moves;
+	}
+
+	void record_probe(bool hit) {
+		table_probes++;
+		table_hits += hit;
+	}
+
+	// Adds the counters of another thread's search of the same move.
+	void merge(const SearchStats &other) {
+		nodes += other.nodes;
+		max_depth = std::max(max_depth, other.max_depth);
+		depth_sum += other.depth_sum;
+		expanded += other.expanded;
+		children += other.children;
+		table_probes += other.table_probes;
+		table_hits += other.table_hits;
+		for (int p = 0; p < SEARCH_PHASES; p++)
+			phase_seconds[p] += other.phase_seconds[p];
+	}
+
+	std::string to_json() const {
+		static const char *const phase_names[SEARCH_PHASES] = {
+		    "movegen", "captures", "eval", "tree", "overhead"};
+		std::ostringstream os;
+		os << "{\"algorithm\": \"" << algorithm << "\", \"move\": " << move
+		   << ", \"threads\": " << threads << ", \"seconds\": " << seconds
+		   << ", \"nodes\": " << nodes
+		   << ", \"nodes_per_second\": " << nodes_per_second()
+		   << ", \"depth\": " << depth << ", \"max_depth\": " << max_depth
+		   << ", \"average_depth\": " << average_depth()
+		   << ", \"effective_branching_factor\": "
+		   << effective_branching_factor()
+		   << ", \"table_probes\": " << table_probes
+		   << ", \"table_hit_rate\": " << table_hit_rate()
+		   << ", \"phase_seconds\": {";
+		for (int p = 0; p < SEARCH_PHASES; p++) {
+			os << (p ? ", \"" : "\"") << phase_names[p]
+			   << "\": " << phase_seconds[p];
+		}
+		os << "}}";
+		return os.str();
+	}
+
+  private:
+	friend class SearchStatsScope;
+
+	PhaseClock clock;
+	uint64_t first_tick = 0;
+	std::chrono::steady_clock::time_point started;
+};
+
+// The SearchStats this thread records into, or null.
+inline SearchStats *&active_search_stats() {
+	static thread_local SearchStats *active = nullptr;
+	return active;
+}
+
+// Ticks a PhaseScope adds per switch, the least of a few timed runs of
+// empty scopes.
+inline double switch_cost_ticks() {
+	static const double cost = [] {
+		PhaseClock clock;
+		PhaseClock *const previous = active_phase_clock();
+		active_phase_clock() = &clock;
+		double least = 1e300;
+		for (int run = 0; run < 8; run++) {
+			const uint64_t start = search_ticks();
+			for (int i = 0; i < 1000; i++) {
+				PhaseScope scope(PHASE_CAPTURES);
+			}
+			least = std::min(least, double(search_ticks() - start) / 2000);
+		}
+		active_phase_clock() = previous;
+		return least;
+	}();
+	return cost;
+}
+
+// Makes `stats` this thread's active statistics for its lifetime, timing
+// the search from construction to destruction in tree bookkeeping unless a
+// PhaseScope says otherwise.
+class SearchStatsScope {
+  public:
+	explicit SearchStatsScope(SearchStats &stats)
+	    : stats(stats), previous(active_search_stats()),
+	      previous_clock(active_phase_clock()) {
+		active_search_stats() = &stats;
+		active_phase_clock() = &stats.clock;
+		stats.started = std::chrono::steady_clock::now();
+		stats.first_tick = stats.clock.last_tick = search_ticks();
+		stats.clock.phase = PHASE_TREE;
+	}
+
+	SearchStatsScope(const SearchStatsScope &) = delete;
+	SearchStatsScope &operator=(const SearchStatsScope &) = delete;
+
+	~SearchStatsScope() {
+		PhaseClock &clock = stats.clock;
+		clock.switch_phase(PHASE_TREE);
+		const double seconds = std::chrono::duration<double>(
+		                           std::chrono::steady_clock::now() -
+		                           stats.started)
+		                           .count();
+		const uint64_t ticks = clock.last_tick - stats.first_tick;
+		const double cost = switch_cost_ticks();
+		double phase_ticks[SEARCH_PHASES] = {};
+		for (int p = 0; p < PHASE_OVERHEAD; p++) {
+			const double overhead =
+			    std::min(double(clock.ticks[p]), cost * clock.switches[p]);
+			phase_ticks[p] = clock.ticks[p] - overhead;
+			phase_ticks[PHASE_OVERHEAD] += overhead;
+		}
+		for (int p = 0; p < SEARCH_PHASES; p++) {
+			if (ticks > 0)
+				stats.phase_seconds[p] += seconds * phase_ticks[p] / ticks;
+			clock.ticks[p] = 0;
+			clock.switches[p] = 0;
+		}
+		active_search_stats() = previous;
+		active_phase_clock() = previous_clock;
+	}
+
+  private:
+	SearchStats &stats;
+	SearchStats *const previous;
+	PhaseClock *const previous_clock;
+};
+
+inline void stats_node(int depth) {
+	if (SearchStats *stats = active_search_stats())
+		stats->record_node(depth);
+}
+
+inline void stats_expansion(int moves) {
+	if (SearchStats *stats = active_search_stats())
+		stats->record_expansion(moves);
+}
+
+inline void stats_probe(bool hit) {
+	if (SearchStats *stats = active_search_stats())
+		stats->record_probe(hit);
+}
+
+#ifdef GIPF_INSTRUMENT
+// Evaluates `call` in instrumented builds only.
+#define GIPF_STATS(call) (call)
+// Records into `stats` until the end of the enclosing block.
+#define GIPF_STATS_SCOPE(stats) \
+	SearchStatsScope GIPF_STATS_CONCAT(stats_scope_, __LINE__)(stats)
+#else
+// Type-checks `call` without evaluating it, so that variables only used
+// for statistics do not trigger warnings.
+#define GIPF_STATS(call) ((void)sizeof((call), 0))
+#define GIPF_STATS_SCOPE(stats) ((void)0)
+#endif
+
+// Appends the statistics of each search to a file as JSON lines. One log
+// may be shared by several searches on different threads.
+class SearchStatsLog {
+  public:
+	// Checks the build before opening, so that a build without
+	// GIPF_INSTRUMENT leaves no empty file behind.
+	explicit SearchStatsLog(const std::string &path) {
+		if (!instrumentation_enabled())
+			throw std::runtime_error("Search statistics need a build with "
+			                         "GIPF_INSTRUMENT");
+		out.open(path, std::ios::app);
+		if (!out)
+			throw std::runtime_error("Cannot open " + path);
+	}
+
+	void write(const SearchStats &stats) {
+		std::lock_guard<std::mutex> lock(mutex);
+		out << stats.to_json() << '\n';
+		out.flush();
+	}
+
+  private:
+	std::mutex mutex;
+	std::ofstream out;
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+
+#include "gipf.h"
+
+/**
+  The 12 symmetries of the hexagonal board: 6 rotations, each optionally
+  preceded by a reflection.
+
+  In axial coordinates a = x - 4, b = y + max(0, x - 4) - 4, a 60 degree
+  rotation maps (a, b) to (a - b, a) and the reflection swaps a and b. Both
+  map the board, its edge cells and the six directions onto themselves.
+
+  Transform t rotates t % 6 times, reflecting first if t >= 6; transform 0
+  is the identity. A board is remapped with byte-sliced lookup tables: one
+  64-bit image per transform, byte position and byte value, so eight loads
+  and ORs per board. The tables are built at compile time.
+
+  Only piece placement is symmetric: position_weights are not, so the
+  static evaluation of two images can differ. Canonical keys therefore suit
+  data that depends on the position alone, such as results, visit counts and
+  training samples, rather than static-evaluation scores.
+*/
+
+const int SYMMETRIES = 12;
+
+struct SymmetryTables {
+	// Destination bit of every bit.
+	std::array<std::array<int, 61>, SYMMETRIES> bit;
+	std::array<std::array<direction, 6>, SYMMETRIES> dir;
+	std::array<std::array<std::array<uint64_t, 256>, 8>, SYMMETRIES> bytes;
+	std::array<int, SYMMETRIES> inverse;
+};
+
+constexpr void symmetry_point(int t, int &a, int &b) {
+	if (t >= 6) {
+		const int swapped = a;
+		a = b;
+		b = swapped;
+	}
+	for (int k = 0; k < t % 6; k++) {
+		const int rotated_a = a - b;
+		b = a;
+		a = rotated_a;
+	}
+}
+
+constexpr SymmetryTables build_symmetry_tables() {
+	SymmetryTables tables{};
+	int cell_at[9][9] = {};
+	for (int x = 0; x < 9; x++) {
+		for (int y = 0; y < COLLEN[x]; y++)
+			cell_at[x][y + std::max(0, x - 4)] = 60 - (COLSUMS[x] + y);
+	}
+
+	for (int t = 0; t < SYMMETRIES; t++) {
+		for (int x = 0; x < 9; x++) {
+			for (int y = 0; y < COLLEN[x]; y++) {
+				int a = x - 4, b = y + std::max(0, x - 4) - 4;
+				symmetry_point(t, a, b);
+				tables.bit[t][60 - (COLSUMS[x] + y)] = cell_at[a + 4][b + 4];
+			}
+		}
+
+		// Every transform fixes the centre, so a direction maps to the
+		// direction from the centre to the image of its neighbour there.
+		for (int d = 0; d < 6; d++) {
+			int nx = 0, ny = 0;
+			neighbour(4, 4, static_cast<direction>(d), nx, ny);
+			const int target = tables.bit[t][60 - (COLSUMS[nx] + ny)];
+			for (int e = 0; e < 6; e++) {
+				int ex = 0, ey = 0;
+				neighbour(4, 4, static_cast<direction>(e), ex, ey);
+				if (60 - (COLSUMS[ex] + ey) == target)
+					tables.dir[t][d] = static_cast<direction>(e);
+			}
+		}
+
+		// Each byte value adds its lowest bit to the image of the value
+		// without it.
+		for (int byte = 0; byte < 8; byte++) {
+			auto &images = tables.bytes[t][byte];
+			for (int value = 1; value < 256; value++) {
+				const int bit = byte * 8 + __builtin_ctz(value);
+				images[value] = images[value & (value - 1)] |
+				                (bit < 61 ? 1ULL << tables.bit[t][bit] : 0);
+			}
+		}
+	}
+
+	for (int t = 0; t < SYMMETRIES; t++) {
+		for (int u = 0; u < SYMMETRIES; u++) {
+			bool identity = true;
+			for (int bit = 0; bit < 61; bit++)
+				identity &= tables.bit[u][tables.bit[t][bit]] == bit;
+			if (identity)
+				tables.inverse[t] = u;
+		}
+	}
+	return tables;
+}
+
+constexpr SymmetryTables symmetry = build_symmetry_tables();
+
+inline uint64_t transform_cells(int t, uint64_t cells) {
+	const auto &bytes = symmetry.bytes[t];
+	return bytes[0][cells & 0xff] | bytes[1][cells >> 8 & 0xff] |
+	       bytes[2][cells >> 16 & 0xff] | bytes[3][cells >> 24 & 0xff] |
+	       bytes[4][cells >> 32 & 0xff] | bytes[5][cells >> 40 & 0xff] |
+	       bytes[6][cells >> 48 & 0xff] | bytes[7][cells >> 56];
+}
+
+inline direction transform_direction(int t, direction dir) {
+	return symmetry.dir[t][static_cast<int>(dir)];
+}
+
+inline int inverse_transform(int t) { return symmetry.inverse[t]; }
+
+inline GipfMove transform_move(int t, const GipfMove &move) {
+	GipfCaptures captures;
+	for (auto row : move.captures)
+		captures.push_back(llint(transform_cells(t, row)));
+	return GipfMove(llint(transform_cells(t, move.elt)),
+	                transform_direction(t, move.dir), captures);
+}
+
+// `state` with both boards mapped by transform t.
+inline GipfState transform_state(int t, const GipfState &state) {
+	GipfState image = state.clone();
+	image.board_1.board = transform_cells(t, state.board_1.board);
+	image.board_2.board = transform_cells(t, state.board_2.board);
+	image.combined.board = image.board_1.board | image.board_2.board;
+	image.key = image.compute_key();
+	image.eval = image.compute_eval();
+	image.legal_pushes = legal_push_mask(image.combined.board);
+	return image;
+}
+
+struct Canonical {
+	uint64_t board_1, board_2;
+	// Maps the original position to the representative.
+	int transform;
+	// Zobrist key of the representative, so equal for all 12 images.
+	uint64_t key;
+};
+
+// The image of `state` with the smallest (board_1, board_2) pair.
+inline Canonical canonicalize(const GipfState &state) {
+	Canonical best{state.board_1.board, state.board_2.board, 0, 0};
+	for (int t = 1; t < SYMMETRIES; t++) {
+		const uint64_t board_1 = transform_cells(t, state.board_1.board);
+		if (board_1 > best.board_1)
+			continue;
+		const uint64_t board_2 = transform_cells(t, state.board_2.board);
+		if (board_1 < best.board_1 || board_2 < best.board_2)
+			best = Canonical{board_1, board_2, t, 0};
+	}
+	best.key = state.key ^ zobrist_cells(0, state.board_1.board) ^
+	           zobrist_cells(1, state.board_2.board) ^
+	           zobrist_cells(0, best.board_1) ^ zobrist_cells(1, best.board_2);
+	return best;
+}
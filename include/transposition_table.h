@@ -0,0 +1,301 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "game_record.h"
+#include "gipf.h"
+
+/**
+  Shared transposition table keyed by GipfState::key.
+
+  The table is a fixed array of 64-byte buckets, each holding four 16-byte
+  entries. Every entry has a 64-bit data word and a check word equal to
+  key ^ data. Both are plain relaxed atomics, so probes and stores never
+  lock. A torn entry, where another thread's store landed between our two
+  loads, fails the XOR check and is treated as a miss.
+
+  Alpha-beta stores a TTEntry: a score, a depth, a bound and the best move
+  as a PackedMove relative to the entry's position. MCTS stores a TTValue:
+  a mean value scaled by TT_VALUE_SCALE and the number of evaluations
+  behind it. The two are packed differently and filed under their own
+  variants of the key, so engines can share a table without an alpha-beta
+  probe finding an MCTS value.
+
+  The probe and store counters are kept per thread, on separate cache
+  lines, and only summed by stats().
+*/
+
+enum TTBound : uint8_t { TT_NONE, TT_EXACT, TT_LOWER, TT_UPPER };
+
+enum TTKind : uint8_t { TT_SEARCH_SCORE, TT_MCTS_VALUE };
+
+const int TT_VALUE_SCALE = 1 << 20;
+const int TT_MAX_DEPTH = 0x7ff;
+const int TT_MAX_VISITS = 0x1ffffff;
+// Push index meaning "no move".
+const uint8_t TT_NO_MOVE = 63;
+
+// An alpha-beta result.
+struct TTEntry {
+	int32_t value = 0;
+	// Saturates at TT_MAX_DEPTH.
+	int depth = 0;
+	PackedMove move{TT_NO_MOVE, 0};
+	TTBound bound = TT_NONE;
+
+	bool has_move() const { return move.push != TT_NO_MOVE; }
+};
+
+// A position's mean MCTS value.
+struct TTValue {
+	int32_t value = 0;
+	// Evaluations in the mean; saturates at TT_MAX_VISITS.
+	int visits = 0;
+};
+
+struct TTStats {
+	unsigned long long probes = 0;
+	unsigned long long hits = 0;
+	unsigned long long stores = 0;
+
+	double hit_rate() const { return probes ? double(hits) / probes : 0; }
+};
+
+class TranspositionTable {
+  public:
+	explicit TranspositionTable(size_t megabytes)
+	    : n_buckets(std::max<size_t>(megabytes * (1 << 20) / sizeof(Bucket),
+	                                 1)),
+	      buckets(static_cast<Bucket *>(aligned_alloc(
+	                  sizeof(Bucket), n_buckets * sizeof(Bucket))),
+	              &free) {
+		if (!buckets)
+			throw std::bad_alloc();
+		clear();
+	}
+
+	size_t size_bytes() const { return n_buckets * sizeof(Bucket); }
+
+	void clear() {
+		memset(static_cast<void *>(buckets.get()), 0, size_bytes());
+		generation = 0;
+	}
+
+	// Ages existing entries so that they are replaced first. Call once per
+	// search, before any thread starts probing.
+	void new_search() { generation = (generation + 1) & 7; }
+
+	bool probe(uint64_t key, TTEntry &entry) const {
+		uint64_t data;
+		if (!find(kind_key(key, TT_SEARCH_SCORE), data))
+			return false;
+		entry = unpack_entry(data);
+		return true;
+	}
+
+	bool probe(uint64_t key, TTValue &entry) const {
+		uint64_t data;
+		if (!find(kind_key(key, TT_MCTS_VALUE), data))
+			return false;
+		entry = unpack_value(data);
+		return true;
+	}
+
+	// Replaces this key's entry if present, keeping its move if `entry` has
+	// none. Otherwise it replaces the entry in the bucket with the least
+	// depth or visits, preferring entries from older searches.
+	void store(uint64_t key, TTEntry entry) {
+		key = kind_key(key, TT_SEARCH_SCORE);
+		Bucket &bucket = bucket_for(key);
+		const int victim = victim_for(bucket, key);
+		if (!entry.has_move()) {
+			const uint64_t data =
+			    bucket.data[victim].load(std::memory_order_relaxed);
+			const uint64_t check =
+			    bucket.check[victim].load(std::memory_order_relaxed);
+			if ((check ^ data) == key)
+				entry.move = unpack_entry(data).move;
+		}
+		write(bucket, victim, key, pack(entry));
+	}
+
+	void store(uint64_t key, TTValue entry) {
+		key = kind_key(key, TT_MCTS_VALUE);
+		Bucket &bucket = bucket_for(key);
+		write(bucket, victim_for(bucket, key), key, pack(entry));
+	}
+
+	TTStats stats() const {
+		TTStats stats;
+		for (const auto &slot : counters) {
+			stats.probes += slot.probes.load(std::memory_order_relaxed);
+			stats.hits += slot.hits.load(std::memory_order_relaxed);
+			stats.stores += slot.stores.load(std::memory_order_relaxed);
+		}
+		return stats;
+	}
+
+	void reset_stats() {
+		for (auto &slot : counters) {
+			slot.probes = 0;
+			slot.hits = 0;
+			slot.stores = 0;
+		}
+	}
+
+	// Fraction of sampled entries written during the current search.
+	double occupancy() const {
+		const size_t sample = std::min<size_t>(n_buckets, 1000);
+		int used = 0;
+		for (size_t b = 0; b < sample; b++) {
+			for (int i = 0; i < ENTRIES; i++) {
+				const uint64_t data =
+				    buckets.get()[b].data[i].load(std::memory_order_relaxed);
+				used += bound_of(data) != TT_NONE &&
+				        generation_of(data) == generation;
+			}
+		}
+		return double(used) / (sample * ENTRIES);
+	}
+
+  private:
+	static constexpr int ENTRIES = 4;
+
+	struct alignas(64) Bucket {
+		std::atomic<uint64_t> check[ENTRIES];
+		std::atomic<uint64_t> data[ENTRIES];
+	};
+	static_assert(sizeof(Bucket) == 64, "a bucket must fill one cache line");
+
+	// One cache line of counters per thread; threads beyond COUNTER_SLOTS
+	// share slots, which the atomic adds keep exact.
+	static constexpr int COUNTER_SLOTS = 64;
+
+	struct alignas(64) Counters {
+		std::atomic<unsigned long long> probes{0}, hits{0}, stores{0};
+	};
+
+	Counters &thread_counters() const {
+		static std::atomic<int> next_slot{0};
+		thread_local const int slot =
+		    next_slot.fetch_add(1, std::memory_order_relaxed) %
+		    COUNTER_SLOTS;
+		return counters[slot];
+	}
+
+	static uint64_t kind_key(uint64_t key, TTKind kind) {
+		return kind == TT_MCTS_VALUE ? key ^ 0x9E3779B97F4A7C15ULL : key;
+	}
+
+	// Finds the data word stored under `key`, which already has its kind
+	// applied, and counts the probe.
+	bool find(uint64_t key, uint64_t &found) const {
+		Counters &counters = thread_counters();
+		counters.probes.fetch_add(1, std::memory_order_relaxed);
+		const Bucket &bucket = bucket_for(key);
+		for (int i = 0; i < ENTRIES; i++) {
+			const uint64_t data =
+			    bucket.data[i].load(std::memory_order_relaxed);
+			const uint64_t check =
+			    bucket.check[i].load(std::memory_order_relaxed);
+			if ((check ^ data) == key && bound_of(data) != TT_NONE) {
+				found = data;
+				counters.hits.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// The slot holding `key`, else an empty one, else the one least worth
+	// keeping.
+	int victim_for(const Bucket &bucket, uint64_t key) const {
+		int victim = 0, victim_priority = INT_MAX;
+		for (int i = 0; i < ENTRIES; i++) {
+			const uint64_t data =
+			    bucket.data[i].load(std::memory_order_relaxed);
+			const uint64_t check =
+			    bucket.check[i].load(std::memory_order_relaxed);
+			if ((check ^ data) == key || bound_of(data) == TT_NONE)
+				return i;
+			const int age = (generation - generation_of(data)) & 7;
+			const int priority = priority_of(data) - 256 * age;
+			if (priority < victim_priority) {
+				victim = i;
+				victim_priority = priority;
+			}
+		}
+		return victim;
+	}
+
+	void write(Bucket &bucket, int slot, uint64_t key, uint64_t data) {
+		thread_counters().stores.fetch_add(1, std::memory_order_relaxed);
+		bucket.data[slot].store(data, std::memory_order_relaxed);
+		bucket.check[slot].store(key ^ data, std::memory_order_relaxed);
+	}
+
+	// Data words hold the value in bits 0-31, the bound in 57-58, whether
+	// the word is a TTValue in 59 and the generation in 61-63. A TTEntry
+	// keeps its depth in bits 32-42, move push in 43-48 and choice in
+	// 49-56; a TTValue keeps its visits in 32-56. Pooled values are always
+	// stored with bound TT_EXACT so that they are never taken for empty.
+	static TTBound bound_of(uint64_t data) {
+		return TTBound((data >> 57) & 3);
+	}
+	static bool is_value(uint64_t data) { return (data >> 59) & 1; }
+	static int generation_of(uint64_t data) { return data >> 61; }
+
+	// Depth, or visits up to TT_MAX_DEPTH, so that popular values compete
+	// with deep results for a slot.
+	static int priority_of(uint64_t data) {
+		const int field = (data >> 32) & TT_MAX_VISITS;
+		return is_value(data) ? std::min(field, TT_MAX_DEPTH)
+		                      : field & TT_MAX_DEPTH;
+	}
+
+	uint64_t pack(const TTEntry &entry) const {
+		const uint64_t depth = std::min(std::max(entry.depth, 0), TT_MAX_DEPTH);
+		return uint64_t(uint32_t(entry.value)) | depth << 32 |
+		       uint64_t(entry.move.push & 63) << 43 |
+		       uint64_t(entry.move.choice) << 49 |
+		       uint64_t(entry.bound & 3) << 57 | uint64_t(generation) << 61;
+	}
+
+	uint64_t pack(const TTValue &entry) const {
+		const uint64_t visits =
+		    std::min(std::max(entry.visits, 0), TT_MAX_VISITS);
+		return uint64_t(uint32_t(entry.value)) | visits << 32 |
+		       uint64_t(TT_EXACT) << 57 | uint64_t(1) << 59 |
+		       uint64_t(generation) << 61;
+	}
+
+	static TTEntry unpack_entry(uint64_t data) {
+		TTEntry entry;
+		entry.value = int32_t(uint32_t(data));
+		entry.depth = (data >> 32) & TT_MAX_DEPTH;
+		entry.move.push = (data >> 43) & 63;
+		entry.move.choice = (data >> 49) & 0xff;
+		entry.bound = bound_of(data);
+		return entry;
+	}
+
+	static TTValue unpack_value(uint64_t data) {
+		TTValue entry;
+		entry.value = int32_t(uint32_t(data));
+		entry.visits = (data >> 32) & TT_MAX_VISITS;
+		return entry;
+	}
+
+	Bucket &bucket_for(uint64_t key) const {
+		return buckets.get()[(unsigned __int128)key * n_buckets >> 64];
+	}
+
+	const size_t n_buckets;
+	std::unique_ptr<Bucket, decltype(&free)> buckets;
+	int generation = 0;
+	mutable Counters counters[COUNTER_SLOTS];
+};
@@ -1,472 +1,435 @@
 #pragma once
 
 #include "direction.h"
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
 #include <vector>
 #include <utility>
 
-const std::vector<int> COLLEN = {5, 6, 7, 8, 9, 8, 7, 6, 5};
-const std::vector<int> COLSUMS = {0, 5, 11, 18, 26, 35, 43, 50, 56};
-
-const char PLAYER_1 = '1';
-const char PLAYER_2 = '2';
-const char EMPTY = '_';
-
-std::unordered_map<int64_t, std::vector<direction>> possible_directions = {
-    {1152921504606846976, {direction::NE}},
-    {36028797018963968, {direction::N, direction::NE}},
-    {562949953421312, {direction::N, direction::NE}},
-    {4398046511104, {direction::N, direction::NE}},
-    {17179869184, {direction::N}},
-    {33554432, {direction::NW, direction::N}},
-    {131072, {direction::NW, direction::N}},
-    {1024, {direction::NW, direction::N}},
-    {16, {direction::NW}},
-    {8, {direction::SW, direction::NW}},
-    {4, {direction::SW, direction::NW}},
-    {2, {direction::SW, direction::NW}},
-    {1, {direction::SW}},
-    {32, {direction::S, direction::SW}},
-    {2048, {direction::S, direction::SW}},
-    {262144, {direction::S, direction::SW}},
-    {67108864, {direction::S}},
-    {34359738368, {direction::SE, direction::S}},
-    {8796093022208, {direction::SE, direction::S}},
-    {1125899906842624, {direction::SE, direction::S}},
-    {72057594037927936, {direction::SE}},
-    {144115188075855872, {direction::NE, direction::SE}},
-    {288230376151711744, {direction::NE, direction::SE}},
-    {576460752303423488, {direction::NE, direction::SE}},
+/**
+  Bitboard geometry.
+
+  Cell (x, y) lives at bit 60 - (COLSUMS[x] + y), so a step in any direction
+  moves a cell by a shift that depends only on its column: N, NE and SE shift
+  towards the low bits, S, SW and NW towards the high bits, and there are at
+  most four distinct shift amounts per direction. Every line on the board is
+  therefore monotonic in bit index, which lets a push find its first empty
+  cell with a single clz/ctz.
+
+  Every table below is computed from COLLEN by a constexpr builder. The
+  tables are fixed at compile time, cost nothing at startup and are shared
+  by every translation unit that includes this header.
+*/
+
+inline constexpr std::array<int, 9> COLLEN = {5, 6, 7, 8, 9, 8, 7, 6, 5};
+
+constexpr std::array<int, 9> build_colsums() {
+	std::array<int, 9> sums{};
+	for (int x = 1; x < 9; x++)
+		sums[x] = sums[x - 1] + COLLEN[x - 1];
+	return sums;
+}
+
+// Index of the first cell of each column in cell order.
+inline constexpr std::array<int, 9> COLSUMS = build_colsums();
+
+constexpr char PLAYER_1 = '1';
+constexpr char PLAYER_2 = '2';
+constexpr char EMPTY = '_';
+
+constexpr int64_t xytoint(int64_t x, int64_t y) {
+	return 1LL << (60 - (COLSUMS[x] + y));
+}
+
+constexpr int64_t no_of_set_bits(int64_t x) { return __builtin_popcountll(x); }
+
+constexpr int64_t build_edge_mask() {
+	int64_t mask = 0;
+	for (int x = 0; x < 9; x++) {
+		for (int y = 0; y < COLLEN[x]; y++) {
+			if (x == 0 || x == 8 || y == 0 || y == COLLEN[x] - 1)
+				mask |= xytoint(x, y);
+		}
+	}
+	return mask;
+}
+
+// The ring of cells pieces are pushed in from; they never hold a piece.
+inline constexpr int64_t EDGE_MASK = build_edge_mask();
+inline constexpr int64_t INTERIOR_MASK = ((1LL << 61) - 1) & ~EDGE_MASK;
+
+constexpr bool in_board(int64_t x) { return (x & EDGE_MASK) == 0; }
+
+struct StepRule {
+	int64_t mask;
+	int shift;
 };
 
-std::unordered_map<direction, direction> reverse_direction = {
-    {direction::N, direction::S},   {direction::NE, direction::SW},
-    {direction::SE, direction::NW}, {direction::S, direction::N},
-    {direction::SW, direction::NE}, {direction::NW, direction::SE},
+using StepRules = std::array<StepRule, 4>;
+
+constexpr bool towards_low_bits(direction dir) {
+	return dir == direction::N || dir == direction::NE || dir == direction::SE;
+}
+
+constexpr bool neighbour(int x, int y, direction dir, int &nx, int &ny) {
+	switch (dir) {
+	case direction::N:
+		nx = x, ny = y + 1;
+		break;
+	case direction::S:
+		nx = x, ny = y - 1;
+		break;
+	case direction::NE:
+		nx = x + 1, ny = (x < 4) ? y + 1 : y;
+		break;
+	case direction::SE:
+		nx = x + 1, ny = (x < 4) ? y : y - 1;
+		break;
+	case direction::SW:
+		nx = x - 1, ny = (x <= 4) ? y - 1 : y;
+		break;
+	case direction::NW:
+		nx = x - 1, ny = (x <= 4) ? y : y + 1;
+		break;
+	}
+	return nx >= 0 && nx < 9 && ny >= 0 && ny < COLLEN[nx];
+}
+
+constexpr std::array<StepRules, 6> build_step_rules() {
+	std::array<StepRules, 6> rules{};
+	for (int d = 0; d < 6; d++) {
+		const auto dir = static_cast<direction>(d);
+		for (int x = 0; x < 9; x++) {
+			for (int y = 0; y < COLLEN[x]; y++) {
+				int nx = 0, ny = 0;
+				if (!neighbour(x, y, dir, nx, ny))
+					continue;
+				const int shift = (COLSUMS[nx] + ny) - (COLSUMS[x] + y);
+				for (auto &rule : rules[d]) {
+					if (rule.mask == 0 || rule.shift == shift) {
+						rule.shift = shift;
+						rule.mask |= xytoint(x, y);
+						break;
+					}
+				}
+			}
+		}
+	}
+	return rules;
+}
+
+inline constexpr std::array<StepRules, 6> step_rules = build_step_rules();
+
+// Moves every cell in `cells` one step in `dir`, dropping the ones that
+// would leave the board.
+constexpr int64_t step_cells(int64_t cells, direction dir) {
+	const auto &rules = step_rules[static_cast<int>(dir)];
+	int64_t out = 0;
+	if (towards_low_bits(dir)) {
+		for (const auto &rule : rules)
+			out |= (cells & rule.mask) >> rule.shift;
+	} else {
+		for (const auto &rule : rules)
+			out |= (cells & rule.mask) << -rule.shift;
+	}
+	return out;
+}
+
+// line_masks[bit][dir] holds the interior cells met when walking from the
+// cell at `bit` in direction `dir` until the far edge, excluding the start.
+constexpr std::array<std::array<int64_t, 6>, 61> build_line_masks() {
+	std::array<std::array<int64_t, 6>, 61> lines{};
+	for (int bit = 0; bit < 61; bit++) {
+		for (int d = 0; d < 6; d++) {
+			const auto dir = static_cast<direction>(d);
+			int64_t next = step_cells(1LL << bit, dir);
+			while (next & INTERIOR_MASK) {
+				lines[bit][d] |= next;
+				next = step_cells(next, dir);
+			}
+		}
+	}
+	return lines;
+}
+
+inline constexpr std::array<std::array<int64_t, 6>, 61> line_masks =
+    build_line_masks();
+
+inline int64_t line_mask(int64_t elt, direction dir) {
+	return line_masks[__builtin_ctzll(elt)][static_cast<int>(dir)];
+}
+
+// Every (entry point, direction) pair a piece can be pushed in from, ordered
+// by entry point.
+struct Push {
+	int64_t elt;
+	direction dir;
 };
 
-std::unordered_map<direction, std::unordered_map<int64_t, int64_t>> next_element = {
-    {direction::N,
-     {{18014398509481984, 9007199254740992},
-      {9007199254740992, 4503599627370496},
-      {36028797018963968, 18014398509481984},
-      {562949953421312, 281474976710656},
-      {4398046511104, 2199023255552},
-      {17179869184, 8589934592},
-      {33554432, 16777216},
-      {131072, 65536},
-      {1024, 512},
-      {4503599627370496, 2251799813685248},
-      {281474976710656, 140737488355328},
-      {140737488355328, 70368744177664},
-      {70368744177664, 35184372088832},
-      {35184372088832, 17592186044416},
-      {2199023255552, 1099511627776},
-      {1099511627776, 549755813888},
-      {549755813888, 274877906944},
-      {274877906944, 137438953472},
-      {137438953472, 68719476736},
-      {8589934592, 4294967296},
-      {4294967296, 2147483648},
-      {2147483648, 1073741824},
-      {1073741824, 536870912},
-      {536870912, 268435456},
-      {268435456, 134217728},
-      {16777216, 8388608},
-      {8388608, 4194304},
-      {4194304, 2097152},
-      {2097152, 1048576},
-      {1048576, 524288},
-      {65536, 32768},
-      {32768, 16384},
-      {16384, 8192},
-      {8192, 4096},
-      {512, 256},
-      {256, 128},
-      {128, 64}}},
-    {direction::NE,
-     {{1152921504606846976, 18014398509481984},
-      {18014398509481984, 140737488355328},
-      {36028797018963968, 281474976710656},
-      {562949953421312, 2199023255552},
-      {4398046511104, 8589934592},
-      {9007199254740992, 70368744177664},
-      {144115188075855872, 2251799813685248},
-      {288230376151711744, 4503599627370496},
-      {576460752303423488, 9007199254740992},
-      {4503599627370496, 35184372088832},
-      {2251799813685248, 17592186044416},
-      {281474976710656, 1099511627776},
-      {140737488355328, 549755813888},
-      {70368744177664, 274877906944},
-      {35184372088832, 137438953472},
-      {17592186044416, 68719476736},
-      {2199023255552, 4294967296},
-      {1099511627776, 2147483648},
-      {549755813888, 1073741824},
-      {274877906944, 536870912},
-      {137438953472, 268435456},
-      {68719476736, 134217728},
-      {8589934592, 16777216},
-      {4294967296, 8388608},
-      {2147483648, 4194304},
-      {1073741824, 2097152},
-      {536870912, 1048576},
-      {268435456, 524288},
-      {16777216, 65536},
-      {8388608, 32768},
-      {4194304, 16384},
-      {2097152, 8192},
-      {1048576, 4096},
-      {65536, 512},
-      {32768, 256},
-      {16384, 128},
-      {8192, 64}}},
-    {direction::SE,
-     {{18014398509481984, 281474976710656},
-      {9007199254740992, 140737488355328},
-      {4503599627370496, 70368744177664},
-      {2251799813685248, 35184372088832},
-      {281474976710656, 2199023255552},
-      {140737488355328, 1099511627776},
-      {70368744177664, 549755813888},
-      {35184372088832, 274877906944},
-      {17592186044416, 137438953472},
-      {2199023255552, 8589934592},
-      {1099511627776, 4294967296},
-      {549755813888, 2147483648},
-      {274877906944, 1073741824},
-      {137438953472, 536870912},
-      {68719476736, 268435456},
-      {4294967296, 16777216},
-      {2147483648, 8388608},
-      {1073741824, 4194304},
-      {536870912, 2097152},
-      {268435456, 1048576},
-      {134217728, 524288},
-      {8388608, 65536},
-      {4194304, 32768},
-      {2097152, 16384},
-      {34359738368, 134217728},
-      {8796093022208, 68719476736},
-      {1125899906842624, 17592186044416},
-      {72057594037927936, 2251799813685248},
-      {144115188075855872, 4503599627370496},
-      {288230376151711744, 9007199254740992},
-      {576460752303423488, 18014398509481984},
-      {1048576, 8192},
-      {524288, 4096},
-      {32768, 512},
-      {16384, 256},
-      {8192, 128},
-      {4096, 64}}},
-    {direction::S,
-     {{9007199254740992, 18014398509481984},
-      {4503599627370496, 9007199254740992},
-      {2251799813685248, 4503599627370496},
-      {140737488355328, 281474976710656},
-      {70368744177664, 140737488355328},
-      {35184372088832, 70368744177664},
-      {17592186044416, 35184372088832},
-      {1099511627776, 2199023255552},
-      {32, 64},
-      {2048, 4096},
-      {262144, 524288},
-      {67108864, 134217728},
-      {34359738368, 68719476736},
-      {8796093022208, 17592186044416},
-      {1125899906842624, 2251799813685248},
-      {549755813888, 1099511627776},
-      {274877906944, 549755813888},
-      {137438953472, 274877906944},
-      {68719476736, 137438953472},
-      {4294967296, 8589934592},
-      {2147483648, 4294967296},
-      {1073741824, 2147483648},
-      {536870912, 1073741824},
-      {268435456, 536870912},
-      {134217728, 268435456},
-      {8388608, 16777216},
-      {4194304, 8388608},
-      {2097152, 4194304},
-      {1048576, 2097152},
-      {524288, 1048576},
-      {32768, 65536},
-      {16384, 32768},
-      {8192, 16384},
-      {4096, 8192},
-      {256, 512},
-      {128, 256},
-      {64, 128}}},
-    {direction::SW,
-     {{140737488355328, 18014398509481984},
-      {70368744177664, 9007199254740992},
-      {35184372088832, 4503599627370496},
-      {17592186044416, 2251799813685248},
-      {1099511627776, 281474976710656},
-      {549755813888, 140737488355328},
-      {274877906944, 70368744177664},
-      {137438953472, 35184372088832},
-      {68719476736, 17592186044416},
-      {4294967296, 2199023255552},
-      {2147483648, 1099511627776},
-      {1073741824, 549755813888},
-      {536870912, 274877906944},
-      {268435456, 137438953472},
-      {134217728, 68719476736},
-      {16777216, 8589934592},
-      {8388608, 4294967296},
-      {4194304, 2147483648},
-      {2097152, 1073741824},
-      {1048576, 536870912},
-      {524288, 268435456},
-      {65536, 16777216},
-      {32768, 8388608},
-      {16384, 4194304},
-      {8192, 2097152},
-      {4096, 1048576},
-      {512, 65536},
-      {8, 512},
-      {4, 256},
-      {2, 128},
-      {1, 64},
-      {32, 4096},
-      {2048, 524288},
-      {262144, 134217728},
-      {256, 32768},
-      {128, 16384},
-      {64, 8192}}},
-    {direction::NW,
-     {{281474976710656, 18014398509481984},
-      {140737488355328, 9007199254740992},
-      {70368744177664, 4503599627370496},
-      {35184372088832, 2251799813685248},
-      {2199023255552, 281474976710656},
-      {1099511627776, 140737488355328},
-      {549755813888, 70368744177664},
-      {274877906944, 35184372088832},
-      {137438953472, 17592186044416},
-      {8589934592, 2199023255552},
-      {4294967296, 1099511627776},
-      {2147483648, 549755813888},
-      {1073741824, 274877906944},
-      {536870912, 137438953472},
-      {268435456, 68719476736},
-      {16777216, 4294967296},
-      {8388608, 2147483648},
-      {4194304, 1073741824},
-      {2097152, 536870912},
-      {1048576, 268435456},
-      {524288, 134217728},
-      {8, 256},
-      {4, 128},
-      {2, 64},
-      {16, 512},
-      {1024, 65536},
-      {131072, 16777216},
-      {33554432, 8589934592},
-      {65536, 8388608},
-      {32768, 4194304},
-      {16384, 2097152},
-      {8192, 1048576},
-      {4096, 524288},
-      {512, 32768},
-      {256, 16384},
-      {128, 8192},
-      {64, 4096}}}};
-
-std::unordered_map<int64_t, std::pair<direction, int64_t>> four_in_a_row_cases = {
-    {33776997205278720, {direction::N, 36028797018963968}},
-    {527765581332480, {direction::N, 562949953421312}},
-    {263882790666240, {direction::N,  562949953421312}},
-    {4123168604160, {direction::N, 4398046511104}},
-    {2061584302080, {direction::N, 4398046511104}},
-    {1030792151040, {direction::N, 4398046511104}},
-    {16106127360, {direction::N, 17179869184}},
-    {8053063680, {direction::N, 17179869184}},
-    {4026531840, {direction::N, 17179869184}},
-    {2013265920, {direction::N, 17179869184}},
-    {31457280, {direction::N, 33554432}},
-    {15728640, {direction::N, 33554432}},
-    {7864320, {direction::N, 33554432}},
-    {122880, {direction::N, 131072}},
-    {61440, {direction::N, 131072}},
-    {960, {direction::N, 1024}},
-    {18155686827393024, {direction::NE, 1152921504606846976}},
-    {141288320008192, {direction::NE, 1152921504606846976}},
-    {550831661056, {direction::NE, 1152921504606846976}},
-    {1075847232, {direction::NE, 1152921504606846976}},
-    {282576640016384, {direction::NE, 36028797018963968}},
-    {1101663322112, {direction::NE, 36028797018963968}},
-    {2151694464, {direction::NE, 36028797018963968}},
-    {2203326644224, {direction::NE, 562949953421312}},
-    {4303388928, {direction::NE, 562949953421312}},
-    {8606777856, {direction::NE, 4398046511104}},
-    {2269460853424128, {direction::NE, 144115188075855872}},
-    {35322080002048, {direction::NE, 288230376151711744}},
-    {4538921706848256, {direction::NE, 288230376151711744}},
-    {275415830528,  {direction::NE, 576460752303423488}},
-    {70644160004096,  {direction::NE, 576460752303423488}},
-    {9077843413696512,  {direction::NE, 576460752303423488}},
-    {2287260137422848, {direction::SE, 72057594037927936}},
-    {35460327931904, {direction::SE, 72057594037927936}},
-    {275955875840, {direction::SE, 72057594037927936}},
-    {1077969408, {direction::SE, 72057594037927936}},
-    {17730163965952, {direction::SE, 1125899906842624}},
-    {137977937920, {direction::SE, 1125899906842624}},
-    {538984704, {direction::SE, 1125899906842624}},
-    {68988968960, {direction::SE, 8796093022208}},
-    {269492352, {direction::SE, 8796093022208}},
-    {134746176, {direction::SE, 34359738368}},
-    {18298081099382784, {direction::SE, 576460752303423488}},
-    {141841311727616, {direction::SE, 288230376151711744}},
-    {9149040549691392, {direction::SE, 288230376151711744}},
-    {551911751680, {direction::SE, 144115188075855872}},
-    {70920655863808, {direction::SE, 144115188075855872}},
-    {4574520274845696, {direction::SE, 144115188075855872}}};
-
-static std::vector<std::string> board_string = {
-    {" +-------------------------------------+ "},
-    {" | A5  B6  C7  D8  E9  F8  G7  H6  I5  | "},
-    {" |                                     | "},
-    {" |                  x                  | "},
-    {" |              x       x              | "},
-    {" |          x       *       x          | "},
-    {" |      x       *       *       x      | "},
-    {" |  x       *       *       *       x  | "},
-    {" |      *       *       *       *      | "},
-    {" |  x       *       *       *       x  | "},
-    {" |      *       *       *       *      | "},
-    {" |  x       *       *       *       x  | "},
-    {" |      *       *       *       *      | "},
-    {" |  x       *       *       *       x  | "},
-    {" |      *       *       *       *      | "},
-    {" |  x       *       *       *       x  | "},
-    {" |      x       *       *       x      | "},
-    {" |          x       *       x          | "},
-    {" |              x       x              | "},
-    {" |                  x                  | "},
-    {" |                                     | "},
-    {" | A1  B1  C1  D1  E1  F1  G1  H1  I1  | "},
-    {" +-------------------------------------+ "}};
-
-static std::unordered_map<direction, std::string> m = {
-    {direction::N, "N"}, {direction::NE, "NE"}, {direction::SE, "SE"},
-    {direction::S, "S"}, {direction::SW, "SW"}, {direction::NW, "NW"}};
-
-int64_t xytoint(int64_t x, int64_t y) { return 1 << (60 - (COLSUMS[x] + y)); }
-
-int64_t no_of_set_bits(int64_t x) {
-	int64_t count = 0;
-	while (x) {
-		count += x & 1;
-		x >>= 1;
+// The directions in clockwise order.
+inline constexpr std::array<direction, 6> clockwise = {
+    {direction::N, direction::NE, direction::SE, direction::S, direction::SW,
+     direction::NW}};
+
+// An edge cell pushes towards each neighbour inside the edge ring: one
+// direction at a corner, two elsewhere. Pushes are ordered by cell, then
+// clockwise. Game records and feature planes index this order, so it must
+// not change.
+constexpr std::array<Push, 42> build_entry_pushes() {
+	std::array<Push, 42> pushes{};
+	int count = 0;
+	for (int bit = 60; bit >= 0; bit--) {
+		if (!(EDGE_MASK >> bit & 1))
+			continue;
+		bool inward[6] = {};
+		for (int k = 0; k < 6; k++)
+			inward[k] = (line_masks[bit][static_cast<int>(clockwise[k])] &
+			             INTERIOR_MASK) != 0;
+		for (int k = 0; k < 6; k++) {
+			if (!inward[k] || inward[(k + 5) % 6])
+				continue;
+			for (int j = k; inward[j % 6] && j < k + 6; j++)
+				pushes[count++] = {1LL << bit, clockwise[j % 6]};
+		}
+	}
+	return pushes;
+}
+
+inline constexpr std::array<Push, 42> entry_pushes = build_entry_pushes();
+
+constexpr std::array<std::array<int8_t, 6>, 61> build_push_indices() {
+	std::array<std::array<int8_t, 6>, 61> indices{};
+	for (auto &row : indices)
+		for (auto &index : row)
+			index = -1;
+	for (int i = 0; i < 42; i++) {
+		const Push &push = entry_pushes[i];
+		indices[__builtin_ctzll(push.elt)][static_cast<int>(push.dir)] = i;
 	}
-	return count;
+	return indices;
+}
+
+inline constexpr std::array<std::array<int8_t, 6>, 61> push_indices =
+    build_push_indices();
+
+// Index of (elt, dir) in entry_pushes, or -1 if it is not an entry push.
+inline int push_index(int64_t elt, direction dir) {
+	return push_indices[__builtin_ctzll(elt)][static_cast<int>(dir)];
+}
+
+constexpr std::array<int64_t, 42> build_push_lines() {
+	std::array<int64_t, 42> lines{};
+	for (int i = 0; i < 42; i++)
+		lines[i] = line_masks[__builtin_ctzll(entry_pushes[i].elt)]
+		                     [static_cast<int>(entry_pushes[i].dir)];
+	return lines;
 }
 
-bool in_board(int64_t x) { return (x & 2271516307835194431) == 0; }
-
-std::unordered_map<direction, std::unordered_map<int64_t, int64_t>> opposite_start_elt = {
-    {direction::N, {{17179869184, 67108864}}},
-    {direction::NE,
-     {{4398046511104, 8},
-      {562949953421312, 4},
-      {36028797018963968, 2},
-      {1152921504606846976, 1},
-      {576460752303423488, 32},
-      {288230376151711744, 2048},
-      {144115188075855872, 262144}}},
-    {direction::SE,
-     {{34359738368, 2},
-      {8796093022208, 4},
-      {1125899906842624, 8},
-      {72057594037927936, 16},
-      {144115188075855872, 1024},
-      {288230376151711744, 131072},
-      {576460752303423488, 33554432}}},
-    {direction::S,
-     {
-         {67108864, 17179869184},
-     }},
-    {direction::SW,
-     {{8, 4398046511104},
-      {4, 562949953421312},
-      {2, 36028797018963968},
-      {1, 1152921504606846976},
-      {32, 576460752303423488},
-      {2048, 288230376151711744},
-      {262144, 144115188075855872}}},
-    {direction::NW,
-     {{2, 34359738368},
-      {4, 8796093022208},
-      {8, 1125899906842624},
-      {16, 72057594037927936},
-      {1024, 144115188075855872},
-      {131072, 288230376151711744},
-      {33554432, 576460752303423488}}}};
-
-std::unordered_map<int64_t, int64_t> position_scores = {
-  {268435456, -10},
-  {134217728, -10},
-  {67108864, -10},
-  {33554432, -10},
-  {16777216, -10},
-  {8388608, -10},
-  {4194304, 0},
-  {2097152, 0},
-  {1048576, 0},
-  {524288, 0},
-  {262144, 0},
-  {131072, -10},
-  {65536, 0},
-  {32768, 10},
-  {16384, 10},
-  {8192, 10},
-  {4096, 10},
-  {2048, 0},
-  {1024, -10},
-  {512, 0},
-  {256, 10},
-  {128, 20},
-  {64, 20},
-  {32, 20},
-  {16, 10},
-  {8, 0},
-  {4, -10},
-  {2, 0},
-  {1, 10},
-  {0, 0},
-  {-2147483648, 20},
-  {1073741824, 30},
-  {536870912, 30},
-  {268435456, 20},
-  {134217728, 10},
-  {67108864, 0},
-  {33554432, -10},
-  {16777216, 0},
-  {8388608, 10},
-  {4194304, 20},
-  {2097152, 30},
-  {1048576, 40},
-  {524288, 30},
-  {262144, 20},
-  {131072, -20},
-  {65536, -10},
-  {32768, 0},
-  {16384, 10},
-  {8192, 20},
-  {4096, 30},
-  {2048, 30},
-  {1024, -30},
-  {512, -20},
-  {256, -10},
-  {128, 0},
-  {64, 10},
-  {32, 20},
-  {16, -40},
-  {8, -30},
-  {4, -20},
-  {2, -10},
-  {1, 0}
+// The cells each entry push can move, indexed like entry_pushes.
+inline constexpr std::array<int64_t, 42> push_lines = build_push_lines();
+
+// Most cells pieces can occupy on one line. Every line is entered by some
+// push, so it is the longest of push_lines.
+constexpr int longest_line() {
+	int longest = 0;
+	for (auto line : push_lines)
+		longest = std::max(longest, __builtin_popcountll(line & INTERIOR_MASK));
+	return longest;
+}
+
+constexpr std::array<uint64_t, 61> build_pushes_through() {
+	std::array<uint64_t, 61> pushes{};
+	for (int i = 0; i < 42; i++) {
+		for (int64_t cells = push_lines[i]; cells; cells &= cells - 1)
+			pushes[__builtin_ctzll(cells)] |= 1ULL << i;
+	}
+	return pushes;
+}
+
+// Bit i of pushes_through[bit] is set if push i's line crosses that cell.
+inline constexpr std::array<uint64_t, 61> pushes_through =
+    build_pushes_through();
+
+// Bit i is set if push i is legal on `combined`, i.e. its line has an
+// empty cell.
+inline uint64_t legal_push_mask(int64_t combined) {
+	uint64_t legal = 0;
+	for (int i = 0; i < 42; i++)
+		legal |= uint64_t((push_lines[i] & ~combined) != 0) << i;
+	return legal;
+}
+
+// Brings `legal` up to date after the occupied cells changed from
+// `old_combined` to `combined`. Emptied cells make every push through them
+// legal. Only the pushes through newly filled cells are tested again.
+inline uint64_t update_legal_pushes(uint64_t legal, int64_t old_combined,
+                                    int64_t combined) {
+	uint64_t freed = 0, recheck = 0;
+	for (int64_t cells = old_combined & ~combined; cells; cells &= cells - 1)
+		freed |= pushes_through[__builtin_ctzll(cells)];
+	for (int64_t cells = combined & ~old_combined; cells; cells &= cells - 1)
+		recheck |= pushes_through[__builtin_ctzll(cells)];
+	recheck &= ~freed;
+	legal = (legal & ~recheck) | freed;
+	for (; recheck; recheck &= recheck - 1) {
+		const int i = __builtin_ctzll(recheck);
+		legal |= uint64_t((push_lines[i] & ~combined) != 0) << i;
+	}
+	return legal;
+}
+
+constexpr int64_t highest_bit(int64_t x) {
+	return 1LL << (63 - __builtin_clzll(x));
+}
+
+constexpr int64_t lowest_bit(int64_t x) { return x & -x; }
+
+// The three line axes, each named by its direction towards the low bits.
+inline constexpr std::array<direction, 3> axes = {
+    {direction::N, direction::NE, direction::SE}};
+
+constexpr direction opposite(direction dir) {
+	switch (dir) {
+	case direction::N:
+		return direction::S;
+	case direction::S:
+		return direction::N;
+	case direction::NE:
+		return direction::SW;
+	case direction::SW:
+		return direction::NE;
+	case direction::SE:
+		return direction::NW;
+	case direction::NW:
+		return direction::SE;
+	}
+	return dir;
+}
+
+// Cells of `board` that end a run of at least four pieces along `dir`.
+inline int64_t four_in_a_row_ends(int64_t board, direction dir) {
+	int64_t run = board;
+	for (int i = 0; i < 3; i++)
+		run = board & step_cells(run, dir);
+	return run;
+}
+
+// Cells of `occupied` reached from the cell at `bit` by walking in `dir`
+// without crossing an empty cell, excluding the start.
+inline int64_t run_from(int bit, direction dir, int64_t occupied) {
+	const int64_t line = line_masks[bit][static_cast<int>(dir)];
+	const int64_t gaps = line & ~occupied;
+	if (gaps == 0)
+		return line;
+	if (towards_low_bits(dir))
+		return line & ~((highest_bit(gaps) << 1) - 1);
+	return line & (lowest_bit(gaps) - 1);
+}
+
+// Positional value of a piece on cell COLSUMS[x] + y, i.e. on bit
+// 60 - (COLSUMS[x] + y). One row per column.
+inline constexpr std::array<int, 61> position_weights = {{
+    -10, -10, -10, -10, -10,
+    -10, 0, 0, 0, 0, 0,
+    -10, 0, 10, 10, 10, 10, 0,
+    -10, 0, 10, 20, 20, 20, 10, 0,
+    -10, 0, 10, 20, 30, 30, 20, 10, 0,
+    -10, 0, 10, 20, 30, 40, 30, 20,
+    -20, -10, 0, 10, 20, 30, 30,
+    -30, -20, -10, 0, 10, 20,
+    -40, -30, -20, -10, 0}};
+
+constexpr int cell_weight(int bit) { return position_weights[60 - bit]; }
+
+// Sum of the positional weights of the cells in `cells`, one cell at a time.
+// Cheapest for the handful of cells a single move changes.
+inline int cell_weights(int64_t cells) {
+	int total = 0;
+	while (cells) {
+		total += cell_weight(__builtin_ctzll(cells));
+		cells &= cells - 1;
+	}
+	return total;
+}
+
+// position_weights split into bit planes: a board scores
+// scale * sum_k 2^k * (popcount(board & positive[k]) -
+//                      popcount(board & negative[k])).
+struct WeightPlanes {
+	int scale = 1;
+	int count = 0;
+	std::array<int64_t, 16> positive{}, negative{};
 };
+
+constexpr WeightPlanes build_weight_planes() {
+	WeightPlanes planes;
+	int scale = 0;
+	for (auto weight : position_weights) {
+		int a = weight < 0 ? -weight : weight, b = scale;
+		while (b) {
+			int t = a % b;
+			a = b;
+			b = t;
+		}
+		scale = a;
+	}
+	planes.scale = std::max(scale, 1);
+	for (int bit = 0; bit < 61; bit++) {
+		const int units = cell_weight(bit) / planes.scale;
+		auto &target = (units < 0) ? planes.negative : planes.positive;
+		for (int k = 0, rest = units < 0 ? -units : units; rest;
+		     k++, rest >>= 1) {
+			if (rest & 1)
+				target[k] |= 1LL << bit;
+			planes.count = std::max(planes.count, k + 1);
+		}
+	}
+	return planes;
+}
+
+inline constexpr WeightPlanes position_planes = build_weight_planes();
+
+inline int positional_score(int64_t board) {
+	int units = 0;
+	for (int k = 0; k < position_planes.count; k++) {
+		units += (__builtin_popcountll(board & position_planes.positive[k]) -
+		          __builtin_popcountll(board & position_planes.negative[k]))
+		         * (1 << k);
+	}
+	return units * position_planes.scale;
+}
+
+constexpr std::array<int, 16> build_reserve_values() {
+	std::array<int, 16> values{};
+	for (int pieces_left = 1; pieces_left < 16; pieces_left++) {
+		// floor(20 * cbrt(pieces_left - 1)) as the largest root whose
+		// cube fits in 8000 * (pieces_left - 1).
+		int root = 0;
+		while ((root + 1) * (root + 1) * (root + 1) <= 8000 * (pieces_left - 1))
+			root++;
+		values[pieces_left] = pieces_left * (280 - root);
+	}
+	return values;
+}
+
+// Value of holding `pieces_left` pieces in reserve, indexed by pieces_left.
+inline constexpr std::array<int, 16> reserve_values = build_reserve_values();
+
+// Everything in the evaluation except piece placement, for the given
+// boards and reserves.
+inline int material_score(int64_t board_1, int64_t board_2,
+                          int pieces_left_1, int pieces_left_2) {
+	int score = reserve_values[pieces_left_1] - reserve_values[pieces_left_2];
+
+	int pieces_board_1 = __builtin_popcountll(board_1);
+	int pieces_board_2 = __builtin_popcountll(board_2);
+	score += (pieces_board_1 - pieces_board_2) * 230;
+
+	int pieces_dead_1 = 15 - pieces_left_1 - pieces_board_1;
+	int pieces_dead_2 = 15 - pieces_left_2 - pieces_board_2;
+	score += (pieces_dead_2 - pieces_dead_1) *
+	         (pieces_dead_2 + pieces_dead_1) * 10;
+	return score;
+}
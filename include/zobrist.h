@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+/**
+  Zobrist keys for GipfState.
+
+  A position key is the XOR of one key per occupied (player, cell), one key per
+  player for the number of pieces left in reserve and a side key when player 2
+  is to move. Moves only touch a few cells, so the key is kept up to date by
+  XORing in the cells that changed. The keys are generated at compile time.
+*/
+
+struct ZobristKeys {
+	std::array<std::array<uint64_t, 61>, 2> cells;
+	std::array<std::array<uint64_t, 16>, 2> reserve;
+	uint64_t side;
+};
+
+constexpr uint64_t splitmix64(uint64_t &x) {
+	uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys build_zobrist_keys() {
+	ZobristKeys keys{};
+	uint64_t seed = 0x6769706621ULL;
+	for (auto &player : keys.cells)
+		for (auto &key : player)
+			key = splitmix64(seed);
+	for (auto &player : keys.reserve)
+		for (auto &key : player)
+			key = splitmix64(seed);
+	keys.side = splitmix64(seed);
+	return keys;
+}
+
+inline constexpr ZobristKeys zobrist = build_zobrist_keys();
+
+// XOR of the cell keys of `player` (0 or 1) for every bit set in `cells`.
+inline uint64_t zobrist_cells(int player, uint64_t cells) {
+	uint64_t key = 0;
+	while (cells) {
+		key ^= zobrist.cells[player][__builtin_ctzll(cells)];
+		cells &= cells - 1;
+	}
+	return key;
+}
+
+inline uint64_t zobrist_reserve(int player, int64_t pieces_left) {
+	assert(pieces_left >= 0 && pieces_left < 16);
+	return zobrist.reserve[player][pieces_left];
+}
@@ -1,119 +1,97 @@
-import time
-import numpy as np
-from operator import itemgetter
+import json
 
+import gipf
 
-def rollout_policy_fn(state):
-    legal_moves = state.get_legal_moves()
-    action_probs = np.random.rand(len(legal_moves))
-    return zip(legal_moves, action_probs)
 
+class CallbackEvaluator(gipf.PUCTEvaluator):
+    """Leaf evaluator built from optional Python callbacks.
 
-def policy_value_fn(state):
-    legal_moves = state.get_legal_moves()
-    action_probs = np.ones(len(legal_moves)) / len(legal_moves)
-    return zip(legal_moves, action_probs), 0
+    prior_fn(state, moves) returns one prior per move and value_fn(state)
+    returns the value of state for the player to move, in [-1, 1]. A missing
+    callback falls back to the native uniform priors or random rollout.
+    """
 
+    def __init__(self, prior_fn=None, value_fn=None, seed=0):
+        gipf.PUCTEvaluator.__init__(self, seed)
+        self._prior_fn = prior_fn
+        self._value_fn = value_fn
 
-class TreeNode(object):
-    def __init__(self, parent, prior_p):
-        self._parent = parent
-        self._children = {}
-        self._n_visits = 0
-        self._Q = 0
-        self._u = 0
-        self._P = prior_p
+    def priors(self, state, moves):
+        if self._prior_fn is None:
+            return gipf.PUCTEvaluator.priors(self, state, moves)
+        return [float(p) for p in self._prior_fn(state, moves)]
 
-    def expand(self, action_priors):
-        for action, prob in action_priors:
-            if action not in self._children:
-                self._children[action] = TreeNode(self, prob)
+    def value(self, state):
+        if self._value_fn is None:
+            return gipf.PUCTEvaluator.value(self, state)
+        return float(self._value_fn(state))
 
-    def select(self, c_puct):
-        return max(self._children.items(),
-                   key=lambda act_node: act_node[1].get_value(c_puct))
 
-    def update(self, leaf_value):
-        self._n_visits += 1
-        self._Q += 1.0 * (leaf_value - self._Q) / self._n_visits
-
-    def update_recursive(self, leaf_value):
-        if self._parent:
-            self._parent.update_recursive(-leaf_value)
-        self.update(leaf_value)
-
-    def get_value(self, c_puct):
-        self._u = (c_puct * self._P *
-                   np.sqrt(self._parent._n_visits) / (1 + self._n_visits))
-        return self._Q + self._u
-
-    def is_leaf(self):
-        return self._children == {}
+class MCTS(object):
+    """PUCT search running natively in gipf.PUCTMCTS.
 
-    def is_root(self):
-        return self._parent is None
+    With no callbacks the whole search stays in C++; otherwise Python is
+    called once per expanded leaf. The tree is kept between moves: a search
+    from the position after our move and the opponent's reply continues from
+    that subtree. With ponder=True the search keeps running on a background
+    thread between calls to get_move.
 
+    In a module built with GIPF_INSTRUMENT, stats_log names a file that
+    every search appends its statistics to as a JSON line, and last_stats()
+    returns those of the latest search.
+    """
 
-class MCTS(object):
-    def __init__(self, policy_value_fn, c_puct=5, t_playout=3):
-        self._root = TreeNode(None, 1.0)
-        self._policy = policy_value_fn
-        self._c_puct = c_puct
+    def __init__(self, prior_fn=None, value_fn=None, c_puct=5, t_playout=3,
+                 n_playout=None, seed=0, ponder=False, stats_log=None):
         self._t_playout = t_playout
-
-    def _playout(self, state):
-        node = self._root
-        while(1):
-            if node.is_leaf():
-                break
-            action, node = node.select(self._c_puct)
-            state.make_move(action)
-        action_probs, _ = self._policy(state)
-        end = state.is_terminal()
-        if not end:
-            node.expand(action_probs)
-        leaf_value = self._evaluate_rollout(state)
-        node.update_recursive(-leaf_value)
-
-    def _evaluate_rollout(self, state, limit=1000):
-        for i in range(limit):
-            end = state.is_terminal()
-            if end:
-                break
-            action_probs = rollout_policy_fn(state)
-            max_action = max(action_probs, key=itemgetter(1))[0]
-            state.make_move(max_action)
-        else:
-            print("WARNING: rollout reached move limit")
-        if state.is_winner(state.player_to_move):
-            return 1
-        elif state.is_winner(state.get_enemy(state.player_to_move)):
-            return -1
+        self._n_playout = n_playout
+        if prior_fn is None and value_fn is None:
+            self._evaluator = None
         else:
-            return 0
+            # Keep a reference: the native search does not own it.
+            self._evaluator = CallbackEvaluator(prior_fn, value_fn, seed)
+        self._search = gipf.PUCTMCTS(c_puct, t_playout)
+        self._search.set_evaluator(self._evaluator)
+        self._search.set_pondering(ponder)
+        # Also kept alive here, for the same reason as the evaluator.
+        self._stats_log = None
+        if stats_log is not None:
+            self._stats_log = gipf.SearchStatsLog(stats_log)
+            self._search.set_stats_log(self._stats_log)
 
     def get_move(self, state):
-        start_time = time.time()
-        while time.time() < start_time + self._t_playout:
-            state_copy = state.clone()
-            self._playout(state_copy)
-        return max(self._root._children.items(),
-                   key=lambda act_node: act_node[1]._n_visits)[0]
+        if self._n_playout is None:
+            return self._search.get_move(state, self._t_playout)
+        return self._search.get_move(state, self._t_playout, self._n_playout)
+
+    def get_move_probs(self, state):
+        """Searches state and returns (moves, visit shares)."""
+        self.get_move(state)
+        return (list(self._search.root_moves()),
+                list(self._search.root_visit_shares()))
+
+    def last_stats(self):
+        """Statistics of the latest search as a dict, empty in builds
+        without GIPF_INSTRUMENT."""
+        if not gipf.instrumentation_enabled():
+            return {}
+        return json.loads(self._search.last_stats.to_json())
 
     def update_with_move(self, last_move):
-        if last_move in self._root._children:
-            self._root = self._root._children[last_move]
-            self._root._parent = None
+        if last_move == -1:
+            self._search.reset()
         else:
-            self._root = TreeNode(None, 1.0)
+            self._search.update_with_move(last_move)
 
     def __str__(self):
         return "MCTS"
 
 
 class MCTSPlayer(object):
-    def __init__(self, c_puct=5, t_playout=3):
-        self.mcts = MCTS(policy_value_fn, c_puct, t_playout)
+    def __init__(self, c_puct=5, t_playout=3, prior_fn=None, value_fn=None,
+                 ponder=False, stats_log=None):
+        self.mcts = MCTS(prior_fn, value_fn, c_puct, t_playout, ponder=ponder,
+                         stats_log=stats_log)
 
     def set_player_ind(self, p):
         self.player = p
@@ -124,9 +102,7 @@ class MCTSPlayer(object):
     def get_action(self, state):
         sensible_moves = state.get_legal_moves()
         if len(sensible_moves) > 0:
-            move = self.mcts.get_move(state)
-            self.mcts.update_with_move(-1)
-            return move
+            return self.mcts.get_move(state)
         else:
             print("WARNING: the board is full")
 
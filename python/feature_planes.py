@@ -0,0 +1,32 @@
+import gipf
+import numpy as np
+
+
+def planes(states, dtype=np.float32, out=None):
+    """Encodes states as an [N, FEATURE_PLANES, 9, 9] array.
+
+    Pass `out` to reuse a buffer; it is filled in place.
+    """
+    if out is None:
+        out = np.empty((len(states), gipf.FEATURE_PLANES, gipf.GRID_SIZE,
+                        gipf.GRID_SIZE), dtype=dtype)
+    gipf.encode_planes_into(states, out)
+    return out
+
+
+def legal_pushes(states, dtype=np.uint8, out=None):
+    """Encodes an [N, PUSH_COUNT] mask of legal pushes, in entry_pushes
+    order."""
+    if out is None:
+        out = np.empty((len(states), gipf.PUSH_COUNT), dtype=dtype)
+    gipf.encode_legal_pushes_into(states, out)
+    return out
+
+
+def goodness(states, out=None):
+    """Scores states as get_goodness would, into an [N] int32 array, with
+    the SIMD batch evaluator."""
+    if out is None:
+        out = np.empty(len(states), dtype=np.int32)
+    gipf.goodness_into(states, out)
+    return out
@@ -0,0 +1,62 @@
+import gipf
+import numpy as np
+
+# Mirrors the structs in include/game_record.h.
+HEADER = np.dtype([
+    ('n_moves', '<u4'),
+    ('flags', '<u4'),
+    ('seed', '<u8'),
+    ('game', '<u8'),
+    ('winner', 'S1'),
+    ('reserved', 'u1', 7),
+])
+MOVE = np.dtype([('push', 'u1'), ('choice', 'u1')])
+STATS = np.dtype([('simulations', '<u4'), ('value', '<f4')])
+RECORD_HAS_STATS = 1
+
+
+class GameRecords(object):
+    """Reads a binary self-play file without copying it.
+
+    The arrays returned point into the memory-mapped file, so they are only
+    valid while this object is alive.
+    """
+
+    def __init__(self, path):
+        self._reader = gipf.GameRecordReader(path)
+        self._data = np.frombuffer(self._reader.buffer(), dtype=np.uint8)
+        self._offsets = np.frombuffer(self._reader.index_buffer(),
+                                      dtype='<u8')
+
+    def __len__(self):
+        return len(self._offsets)
+
+    def header(self, i):
+        offset = int(self._offsets[i])
+        return self._data[offset:offset + HEADER.itemsize].view(HEADER)[0]
+
+    def moves(self, i):
+        """Packed moves of game i as a structured (push, choice) array."""
+        offset = int(self._offsets[i]) + HEADER.itemsize
+        n = int(self.header(i)['n_moves'])
+        return self._data[offset:offset + n * MOVE.itemsize].view(MOVE)
+
+    def stats(self, i):
+        """Search statistics of game i, or None if it has none."""
+        header = self.header(i)
+        if not header['flags'] & RECORD_HAS_STATS:
+            return None
+        n = int(header['n_moves'])
+        offset = (int(self._offsets[i]) + HEADER.itemsize +
+                  (n * MOVE.itemsize + 7) // 8 * 8)
+        return self._data[offset:offset + n * STATS.itemsize].view(STATS)
+
+    def states(self, i):
+        """Yields (state, move) for every ply of game i.
+
+        Each state is a copy, so it stays valid after the iteration moves on.
+        """
+        replay = gipf.GameReplay(self._reader.game(i))
+        while not replay.done():
+            yield replay.state.clone(), replay.move()
+            replay.next()
@@ -0,0 +1,258 @@
+#include "batch_goodness.h"
+
+#include <climits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GIPF_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// get_goodness from the fields of a position, term for term.
+int scalar_goodness(uint64_t board_1, uint64_t board_2, int pieces_left_1,
+                    int pieces_left_2, char player_to_move) {
+	const bool first = player_to_move == PLAYER_1;
+	if ((first ? pieces_left_2 : pieces_left_1) <= 0)
+		return INT_MAX;
+	if ((first ? pieces_left_1 : pieces_left_2) <= 0)
+		return INT_MIN;
+	const int eval =
+	    material_score(board_1, board_2, pieces_left_1, pieces_left_2) +
+	    positional_score(board_1) - positional_score(board_2);
+	return (player_to_move == PLAYER_2) ? -eval : eval;
+}
+
+void goodness_scalar(const PositionArrays &p, int *out, size_t from) {
+	for (size_t i = from; i < p.size; i++)
+		out[i] = scalar_goodness(p.board_1[i], p.board_2[i],
+		                         p.pieces_left_1[i], p.pieces_left_2[i],
+		                         p.player_to_move[i]);
+}
+
+#ifdef GIPF_X86
+
+// Loads eight int8 fields and widens them to 32 bits.
+__attribute__((target("avx2"))) inline __m256i
+load_widened(const void *fields) {
+	return _mm256_cvtepi8_epi32(
+	    _mm_loadl_epi64(static_cast<const __m128i *>(fields)));
+}
+
+// reserve_values[pieces_left] in each lane, for pieces_left in 0..15.
+__attribute__((target("avx2"))) inline __m256i
+reserve_value(__m256i pieces_left) {
+	const __m256i low = _mm256_loadu_si256(
+	    reinterpret_cast<const __m256i *>(reserve_values.data()));
+	const __m256i high = _mm256_loadu_si256(
+	    reinterpret_cast<const __m256i *>(reserve_values.data() + 8));
+	return _mm256_blendv_epi8(
+	    _mm256_permutevar8x32_epi32(low, pieces_left),
+	    _mm256_permutevar8x32_epi32(high, pieces_left),
+	    _mm256_cmpgt_epi32(pieces_left, _mm256_set1_epi32(7)));
+}
+
+// Finishes eight positions starting at `i` from their piece counts and the
+// difference of their positional scores in units of position_planes.scale.
+__attribute__((target("avx2"))) inline __m256i
+finish_goodness(const PositionArrays &p, size_t i, __m256i count_1,
+                __m256i count_2, __m256i units) {
+	const __m256i left_1 = load_widened(p.pieces_left_1 + i);
+	const __m256i left_2 = load_widened(p.pieces_left_2 + i);
+	const __m256i player = load_widened(p.player_to_move + i);
+
+	__m256i score =
+	    _mm256_sub_epi32(reserve_value(left_1), reserve_value(left_2));
+	score = _mm256_add_epi32(
+	    score, _mm256_mullo_epi32(_mm256_sub_epi32(count_1, count_2),
+	                              _mm256_set1_epi32(230)));
+	const __m256i fifteen = _mm256_set1_epi32(15);
+	const __m256i dead_1 =
+	    _mm256_sub_epi32(_mm256_sub_epi32(fifteen, left_1), count_1);
+	const __m256i dead_2 =
+	    _mm256_sub_epi32(_mm256_sub_epi32(fifteen, left_2), count_2);
+	score = _mm256_add_epi32(
+	    score, _mm256_mullo_epi32(
+	               _mm256_mullo_epi32(_mm256_sub_epi32(dead_2, dead_1),
+	                                  _mm256_add_epi32(dead_2, dead_1)),
+	               _mm256_set1_epi32(10)));
+	score = _mm256_add_epi32(
+	    score, _mm256_mullo_epi32(
+	               units, _mm256_set1_epi32(position_planes.scale)));
+
+	const __m256i first =
+	    _mm256_cmpeq_epi32(player, _mm256_set1_epi32(PLAYER_1));
+	const __m256i second =
+	    _mm256_cmpeq_epi32(player, _mm256_set1_epi32(PLAYER_2));
+	score = _mm256_blendv_epi8(
+	    score, _mm256_sub_epi32(_mm256_setzero_si256(), score), second);
+
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i lost =
+	    _mm256_cmpgt_epi32(one, _mm256_blendv_epi8(left_2, left_1, first));
+	const __m256i won =
+	    _mm256_cmpgt_epi32(one, _mm256_blendv_epi8(left_1, left_2, first));
+	score = _mm256_blendv_epi8(score, _mm256_set1_epi32(INT_MIN), lost);
+	return _mm256_blendv_epi8(score, _mm256_set1_epi32(INT_MAX), won);
+}
+
+// Bits set in each 64-bit lane, counted a nibble at a time.
+__attribute__((target("avx2"))) inline __m256i popcount_avx2(__m256i x) {
+	const __m256i table =
+	    _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0,
+	                     1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const __m256i counts = _mm256_add_epi8(
+	    _mm256_shuffle_epi8(table, _mm256_and_si256(x, nibble)),
+	    _mm256_shuffle_epi8(
+	        table, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+	return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+// Counts and positional units of four positions in 64-bit lanes.
+struct LaneCounts {
+	__m256i count_1, count_2, units;
+};
+
+__attribute__((target("avx2"))) inline LaneCounts
+count_avx2(const uint64_t *board_1, const uint64_t *board_2) {
+	const __m256i b1 =
+	    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(board_1));
+	const __m256i b2 =
+	    _mm256_loadu_si256(reinterpret_cast<const __m256i *>(board_2));
+	// Highest plane first, doubling the sum so far before adding each.
+	__m256i units = _mm256_setzero_si256();
+	for (int k = position_planes.count - 1; k >= 0; k--) {
+		const __m256i positive =
+		    _mm256_set1_epi64x(position_planes.positive[k]);
+		const __m256i negative =
+		    _mm256_set1_epi64x(position_planes.negative[k]);
+		const __m256i gain =
+		    _mm256_add_epi64(popcount_avx2(_mm256_and_si256(b1, positive)),
+		                     popcount_avx2(_mm256_and_si256(b2, negative)));
+		const __m256i loss =
+		    _mm256_add_epi64(popcount_avx2(_mm256_and_si256(b1, negative)),
+		                     popcount_avx2(_mm256_and_si256(b2, positive)));
+		units = _mm256_add_epi64(_mm256_add_epi64(units, units),
+		                         _mm256_sub_epi64(gain, loss));
+	}
+	return LaneCounts{popcount_avx2(b1), popcount_avx2(b2), units};
+}
+
+// The low halves of the 64-bit lanes of `low` and then `high`.
+__attribute__((target("avx2"))) inline __m256i narrow(__m256i low,
+                                                      __m256i high) {
+	const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	return _mm256_permute2x128_si256(_mm256_permutevar8x32_epi32(low, even),
+	                                 _mm256_permutevar8x32_epi32(high, even),
+	                                 0x20);
+}
+
+__attribute__((target("avx2"))) size_t goodness_avx2(const PositionArrays &p,
+                                                     int *out) {
+	size_t i = 0;
+	for (; i + 8 <= p.size; i += 8) {
+		const LaneCounts low = count_avx2(p.board_1 + i, p.board_2 + i);
+		const LaneCounts high =
+		    count_avx2(p.board_1 + i + 4, p.board_2 + i + 4);
+		const __m256i goodness =
+		    finish_goodness(p, i, narrow(low.count_1, high.count_1),
+		                    narrow(low.count_2, high.count_2),
+		                    narrow(low.units, high.units));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), goodness);
+	}
+	return i;
+}
+
+// The low halves of the 64-bit lanes of `x`. The zero-masked form keeps
+// GCC from warning about the undefined pass-through of the plain one.
+__attribute__((target("avx2,avx512f"))) inline __m256i narrow(__m512i x) {
+	return _mm512_maskz_cvtepi64_epi32(0xff, x);
+}
+
+__attribute__((target("avx2,avx512f,avx512vpopcntdq"))) size_t
+goodness_avx512(const PositionArrays &p, int *out) {
+	size_t i = 0;
+	for (; i + 8 <= p.size; i += 8) {
+		const __m512i b1 = _mm512_loadu_si512(p.board_1 + i);
+		const __m512i b2 = _mm512_loadu_si512(p.board_2 + i);
+		__m512i units = _mm512_setzero_si512();
+		for (int k = position_planes.count - 1; k >= 0; k--) {
+			const __m512i positive =
+			    _mm512_set1_epi64(position_planes.positive[k]);
+			const __m512i negative =
+			    _mm512_set1_epi64(position_planes.negative[k]);
+			const __m512i gain = _mm512_add_epi64(
+			    _mm512_popcnt_epi64(_mm512_and_si512(b1, positive)),
+			    _mm512_popcnt_epi64(_mm512_and_si512(b2, negative)));
+			const __m512i loss = _mm512_add_epi64(
+			    _mm512_popcnt_epi64(_mm512_and_si512(b1, negative)),
+			    _mm512_popcnt_epi64(_mm512_and_si512(b2, positive)));
+			units = _mm512_add_epi64(_mm512_add_epi64(units, units),
+			                         _mm512_sub_epi64(gain, loss));
+		}
+		const __m256i goodness =
+		    finish_goodness(p, i, narrow(_mm512_popcnt_epi64(b1)),
+		                    narrow(_mm512_popcnt_epi64(b2)), narrow(units));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), goodness);
+	}
+	return i;
+}
+
+#endif
+
+} // namespace
+
+bool eval_kernel_supported(EvalKernel kernel) {
+	switch (kernel) {
+	case EvalKernel::SCALAR:
+		return true;
+#ifdef GIPF_X86
+	case EvalKernel::AVX2:
+		return __builtin_cpu_supports("avx2");
+	case EvalKernel::AVX512:
+		return __builtin_cpu_supports("avx2") &&
+		       __builtin_cpu_supports("avx512f") &&
+		       __builtin_cpu_supports("avx512vpopcntdq");
+#endif
+	default:
+		return false;
+	}
+}
+
+const char *eval_kernel_name(EvalKernel kernel) {
+	switch (kernel) {
+	case EvalKernel::SCALAR:
+		return "scalar";
+	case EvalKernel::AVX2:
+		return "avx2";
+	case EvalKernel::AVX512:
+		return "avx512";
+	}
+	return "unknown";
+}
+
+EvalKernel best_eval_kernel() {
+	static const EvalKernel best =
+	    eval_kernel_supported(EvalKernel::AVX512)
+	        ? EvalKernel::AVX512
+	        : eval_kernel_supported(EvalKernel::AVX2) ? EvalKernel::AVX2
+	                                                  : EvalKernel::SCALAR;
+	return best;
+}
+
+void batch_goodness(const PositionArrays &positions, int *out,
+                    EvalKernel kernel) {
+	if (!eval_kernel_supported(kernel))
+		throw std::invalid_argument(std::string("Evaluation kernel ") +
+		                            eval_kernel_name(kernel) +
+		                            " is not supported on this CPU");
+	size_t done = 0;
+#ifdef GIPF_X86
+	if (kernel == EvalKernel::AVX512)
+		done = goodness_avx512(positions, out);
+	else if (kernel == EvalKernel::AVX2)
+		done = goodness_avx2(positions, out);
+#endif
+	goodness_scalar(positions, out, done);
+}
@@ -0,0 +1,86 @@
+#include "batch_goodness.h"
+#include "gipf.h"
+
+#include <cstdlib>
+
+/**
+  Checks every evaluation kernel this CPU supports against
+  GipfState::get_goodness. Positions come from seeded random games, played
+  to the end so that terminal positions are included, and from the same
+  boards with random reserves. Every prefix length up to a few vector
+  widths is scored on its own so that each kernel's scalar tail is
+  covered.
+
+  Usage:
+    batch_goodness_test [positions]
+*/
+
+// Random games, and the same boards with every reserve from 0 to 15.
+vector<GipfState> sample_positions(int positions, mt19937_64 &rng) {
+	vector<GipfState> states;
+	while ((int)states.size() < positions) {
+		GipfState state;
+		for (int ply = 0; ply < 300; ply++) {
+			states.push_back(state.clone());
+			GipfState varied = state.clone();
+			varied.pieces_left_1 = rng() % 16;
+			varied.pieces_left_2 = rng() % 16;
+			varied.eval = varied.compute_eval();
+			states.push_back(varied);
+			if (state.is_terminal())
+				break;
+			GipfMoveList moves;
+			state.generate_moves(moves);
+			state.make_move(moves[rng() % moves.size()]);
+		}
+	}
+	return states;
+}
+
+// Returns the number of positions in [first, first + n) that `kernel`
+// scores differently from get_goodness.
+int check_range(const vector<GipfState> &states, size_t first, size_t n,
+                EvalKernel kernel) {
+	PositionBatch batch;
+	for (size_t i = first; i < first + n; i++)
+		batch.push_back(states[i]);
+	vector<int> scores(n);
+	batch_goodness(batch.arrays(), scores.data(), kernel);
+
+	int failures = 0;
+	for (size_t i = 0; i < n; i++) {
+		const int expected = states[first + i].get_goodness();
+		if (scores[i] != expected && failures++ < 3)
+			cout << eval_kernel_name(kernel) << ": position " << first + i
+			     << " scored " << scores[i] << ", expected " << expected
+			     << endl;
+	}
+	return failures;
+}
+
+int main(int argc, char *argv[]) {
+	const int positions = (argc > 1) ? atoi(argv[1]) : 20000;
+	mt19937_64 rng(1);
+	const vector<GipfState> states = sample_positions(positions, rng);
+	int terminal = 0;
+	for (const auto &state : states)
+		terminal += state.is_terminal();
+
+	int failures = 0;
+	for (auto kernel :
+	     {EvalKernel::SCALAR, EvalKernel::AVX2, EvalKernel::AVX512}) {
+		if (!eval_kernel_supported(kernel)) {
+			cout << eval_kernel_name(kernel) << ": not supported, skipped"
+			     << endl;
+			continue;
+		}
+		int kernel_failures = check_range(states, 0, states.size(), kernel);
+		for (size_t n = 1; n <= 40; n++)
+			kernel_failures += check_range(states, rng() % 1000, n, kernel);
+		cout << eval_kernel_name(kernel) << ": " << states.size()
+		     << " positions, " << terminal << " terminal, "
+		     << kernel_failures << " mismatches" << endl;
+		failures += kernel_failures;
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
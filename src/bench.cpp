@@ -0,0 +1,247 @@
+#include "batch_goodness.h"
+#include "gipf.h"
+#include "playout.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+/**
+  Micro-benchmarks for the engine hot paths over a corpus of midgame
+  positions taken from seeded random games. Results are written to stdout
+  as JSON so that builds can be compared.
+
+  Usage:
+    bench [--seed N] [--positions N] [--runs N] [--min-time SECONDS]
+*/
+
+struct BenchConfig {
+	unsigned long long seed = 1;
+	int positions = 1000;
+	int runs = 5;
+	double min_time = 0.1;
+};
+
+struct BenchResult {
+	string name;
+	unsigned long long ops;
+	vector<double> ns_per_op;
+};
+
+// Accumulates results so the compiler cannot drop the benchmarked calls.
+volatile unsigned long long sink;
+
+vector<GipfState> make_corpus(const BenchConfig &config) {
+	mt19937_64 rng(config.seed);
+	vector<GipfState> corpus;
+	while ((int)corpus.size() < config.positions) {
+		GipfState state;
+		int plies = 10 + rng() % 50;
+		for (int ply = 0; ply < plies && !state.is_terminal(); ply++) {
+			GipfMoveList moves;
+			state.generate_moves(moves);
+			state.make_move(moves[rng() % moves.size()]);
+		}
+		if (!state.is_terminal())
+			corpus.push_back(state.clone());
+	}
+	return corpus;
+}
+
+// Runs `pass`, which performs `ops` operations, until `min_time` has
+// elapsed, `runs` times over, and records nanoseconds per operation.
+BenchResult measure(const string &name, const BenchConfig &config,
+                    unsigned long long ops, const function<void()> &pass) {
+	BenchResult result{name, ops, {}};
+	pass();
+	for (int run = 0; run < config.runs; run++) {
+		long passes = 0;
+		auto start = chrono::steady_clock::now();
+		chrono::duration<double> elapsed(0);
+		while (elapsed.count() < config.min_time) {
+			pass();
+			passes++;
+			elapsed = chrono::steady_clock::now() - start;
+		}
+		result.ns_per_op.push_back(elapsed.count() * 1e9 / (passes * ops));
+	}
+	sort(result.ns_per_op.begin(), result.ns_per_op.end());
+	return result;
+}
+
+void print_json(const BenchConfig &config, const vector<BenchResult> &results) {
+	cout << "{\n  \"seed\": " << config.seed
+	     << ",\n  \"positions\": " << config.positions
+	     << ",\n  \"runs\": " << config.runs << ",\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto &result = results[i];
+		const auto &times = result.ns_per_op;
+		cout << "    {\"name\": \"" << result.name
+		     << "\", \"ops_per_pass\": " << result.ops
+		     << ", \"min_ns\": " << times.front()
+		     << ", \"median_ns\": " << times[times.size() / 2]
+		     << ", \"max_ns\": " << times.back()
+		     << ", \"ops_per_second\": " << 1e9 / times[times.size() / 2]
+		     << "}"
+		     << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	cout << "  ]\n}" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	BenchConfig config;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--seed")) {
+			config.seed = strtoull(argv[i + 1], nullptr, 10);
+		} else if (!strcmp(argv[i], "--positions")) {
+			config.positions = max(1, atoi(argv[i + 1]));
+		} else if (!strcmp(argv[i], "--runs")) {
+			config.runs = max(1, atoi(argv[i + 1]));
+		} else if (!strcmp(argv[i], "--min-time")) {
+			config.min_time = atof(argv[i + 1]);
+		} else {
+			cerr << "Unknown option " << argv[i] << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	auto corpus = make_corpus(config);
+
+	// Every legal push of every position, and the states right after them
+	// with captures still on the board.
+	vector<Push> pushes;
+	vector<const GipfState *> push_states;
+	vector<GipfState> pushed;
+	vector<vector<GipfMove>> legal_moves;
+	unsigned long long n_moves = 0;
+	for (const auto &state : corpus) {
+		for (const auto &push : entry_pushes) {
+			if (!state.combined.CanMove(push.elt, push.dir))
+				continue;
+			pushes.push_back(push);
+			push_states.push_back(&state);
+			GipfState after = state.clone();
+			after.SlidePieces(push.elt, push.dir);
+			pushed.push_back(after);
+		}
+		legal_moves.push_back(state.get_legal_moves());
+		n_moves += legal_moves.back().size();
+	}
+
+	vector<BenchResult> results;
+	results.push_back(measure("CanMove", config, corpus.size() * 42, [&] {
+		unsigned long long total = 0;
+		for (const auto &state : corpus)
+			for (const auto &push : entry_pushes)
+				total += state.combined.CanMove(push.elt, push.dir);
+		sink += total;
+	}));
+	results.push_back(measure("SlidePieces", config, pushes.size(), [&] {
+		unsigned long long total = 0;
+		for (size_t i = 0; i < pushes.size(); i++) {
+			const auto *state = push_states[i];
+			Board board = state->board_1, combined = state->combined;
+			board.SlidePieces(pushes[i].elt, pushes[i].dir, combined);
+			total += board.board ^ combined.board;
+		}
+		sink += total;
+	}));
+	results.push_back(
+	    measure("GetCaptureMaskSets", config, pushed.size(), [&] {
+		    unsigned long long total = 0;
+		    for (auto &state : pushed)
+			    total += state.GetCaptureMaskSets().size();
+		    sink += total;
+	    }));
+	results.push_back(measure("get_legal_moves", config, corpus.size(), [&] {
+		unsigned long long total = 0;
+		for (const auto &state : corpus)
+			total += state.get_legal_moves().size();
+		sink += total;
+	}));
+	results.push_back(measure("generate_moves", config, corpus.size(), [&] {
+		unsigned long long total = 0;
+		GipfMoveList moves;
+		for (const auto &state : corpus) {
+			moves.clear();
+			state.generate_moves(moves);
+			total += moves.size();
+		}
+		sink += total;
+	}));
+	results.push_back(measure("make_move/undo_move", config, n_moves, [&] {
+		unsigned long long total = 0;
+		for (size_t i = 0; i < corpus.size(); i++) {
+			for (const auto &move : legal_moves[i]) {
+				corpus[i].make_move(move);
+				total += corpus[i].key;
+				corpus[i].undo_move(move);
+			}
+		}
+		sink += total;
+	}));
+	results.push_back(measure("clone", config, corpus.size(), [&] {
+		unsigned long long total = 0;
+		for (const auto &state : corpus)
+			total += state.clone().board_1.board;
+		sink += total;
+	}));
+	results.push_back(measure("hash", config, corpus.size(), [&] {
+		unsigned long long total = 0;
+		for (const auto &state : corpus)
+			total += state.hash();
+		sink += total;
+	}));
+	results.push_back(measure("get_goodness", config, corpus.size(), [&] {
+		unsigned long long total = 0;
+		for (const auto &state : corpus)
+			total += state.get_goodness();
+		sink += total;
+	}));
+	PositionBatch batch;
+	for (const auto &state : corpus)
+		batch.push_back(state);
+	vector<int> goodness(batch.size());
+	for (auto kernel :
+	     {EvalKernel::SCALAR, EvalKernel::AVX2, EvalKernel::AVX512}) {
+		if (!eval_kernel_supported(kernel))
+			continue;
+		const string name =
+		    string("batch_goodness/") + eval_kernel_name(kernel);
+		results.push_back(measure(name, config, batch.size(), [&] {
+			batch_goodness(batch.arrays(), goodness.data(), kernel);
+			sink += goodness[0];
+		}));
+	}
+
+	results.push_back(measure("random_playout", config, corpus.size(), [&] {
+		mt19937_64 rng(config.seed);
+		unsigned long long total = 0;
+		for (const auto &state : corpus)
+			total += random_playout(state, rng).plies;
+		sink += total;
+	}));
+	results.push_back(
+	    measure("generate_moves_playout", config, corpus.size(), [&] {
+		    mt19937_64 rng(config.seed);
+		    unsigned long long total = 0;
+		    GipfMoveList moves;
+		    for (const auto &state : corpus) {
+			    GipfState playout = state.clone();
+			    for (int ply = 0; ply < 1000 && !playout.is_terminal();
+			         ply++) {
+				    moves.clear();
+				    playout.generate_moves(moves);
+				    if (moves.empty())
+					    break;
+				    playout.apply_move(moves[rng() % moves.size()]);
+				    total++;
+			    }
+		    }
+		    sink += total;
+	    }));
+
+	print_json(config, results);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+#include "gipf.h"
+
+#include <cstdlib>
+
+/**
+  Checks GipfState::FindCaptureSets against a brute-force reference that
+  walks every line cell by cell and tries every subset of the rows found.
+  Every set must be reported, and never more than MAX_CAPTURE_SETS.
+  Boards come from every push in seeded random games and in positions
+  climbed, one cell at a time, towards pushes with ever more capture sets,
+  starting from random boards or from the richest positions known. The
+  positions keep to what MAX_CAPTURE_SETS assumes: no rows and at most 15
+  pieces a side.
+
+  Usage:
+    capture_test [boards]
+*/
+
+using CaptureSet = vector<llint>;
+
+// The cells of every line along `axis`, in walking order.
+vector<vector<int>> board_lines(direction axis) {
+	vector<vector<int>> lines;
+	for (int x = 0; x < 9; x++) {
+		for (int y = 0; y < COLLEN[x]; y++) {
+			int px = 0, py = 0;
+			if (neighbour(x, y, opposite(axis), px, py))
+				continue;
+			vector<int> line;
+			for (int cx = x, cy = y, nx = 0, ny = 0;; cx = nx, cy = ny) {
+				line.push_back(60 - (COLSUMS[cx] + cy));
+				if (!neighbour(cx, cy, axis, nx, ny))
+					break;
+			}
+			lines.push_back(line);
+		}
+	}
+	return lines;
+}
+
+// Every run of four or more pieces of `board`, extended over the occupied
+// cells on either side, each row once.
+void reference_rows(ullint board, ullint combined,
+                    const vector<vector<int>> &lines, vector<llint> &rows) {
+	auto has = [](ullint cells, int bit) { return (cells >> bit & 1) != 0; };
+	for (const auto &line : lines) {
+		const int n = line.size();
+		for (int start = 0; start < n;) {
+			int end = start;
+			while (end < n && has(board, line[end]))
+				end++;
+			if (end - start >= 4) {
+				int first = start, last = end;
+				while (first > 0 && has(combined, line[first - 1]))
+					first--;
+				while (last < n && has(combined, line[last]))
+					last++;
+				llint row = 0;
+				for (int i = first; i < last; i++)
+					row |= 1LL << line[i];
+				if (find(rows.begin(), rows.end(), row) == rows.end())
+					rows.push_back(row);
+			}
+			start = max(end, start + 1);
+		}
+	}
+}
+
+// The maximal sets of pairwise disjoint rows, each sorted, in sorted order.
+vector<CaptureSet> reference_sets(const vector<llint> &rows) {
+	const int n = rows.size();
+	vector<CaptureSet> sets;
+	for (uint32_t subset = 1; n > 0 && subset < (1u << n); subset++) {
+		llint covered = 0;
+		bool disjoint = true;
+		for (int i = 0; i < n; i++) {
+			if (subset >> i & 1) {
+				disjoint &= (covered & rows[i]) == 0;
+				covered |= rows[i];
+			}
+		}
+		bool maximal = true;
+		for (int i = 0; i < n; i++) {
+			if (!(subset >> i & 1) && (covered & rows[i]) == 0)
+				maximal = false;
+		}
+		if (!disjoint || !maximal)
+			continue;
+		CaptureSet set;
+		for (int i = 0; i < n; i++) {
+			if (subset >> i & 1)
+				set.push_back(rows[i]);
+		}
+		sort(set.begin(), set.end());
+		sets.push_back(set);
+	}
+	sort(sets.begin(), sets.end());
+	return sets;
+}
+
+// Compares FindCaptureSets with the reference on one board and returns
+// whether they agree. Sets `n_sets` to the number of reference sets.
+bool check_board(ullint own, ullint other,
+                 const vector<vector<int>> (&lines)[3], int &n_sets) {
+	const ullint combined = own | other;
+	vector<llint> rows;
+	for (auto board : {own, other}) {
+		for (const auto &axis_lines : lines)
+			reference_rows(board, combined, axis_lines, rows);
+	}
+	const vector<CaptureSet> expected = reference_sets(rows);
+	n_sets = expected.size();
+
+	vector<CaptureSet> actual;
+	try {
+		GipfState::FindCaptureSets(own, other, combined,
+		                           [&](const GipfCaptures &found) {
+			                           CaptureSet set(found.begin(),
+			                                          found.end());
+			                           sort(set.begin(), set.end());
+			                           actual.push_back(set);
+		                           });
+	} catch (const logic_error &error) {
+		cout << error.what() << endl;
+		return false;
+	}
+	sort(actual.begin(), actual.end());
+	return actual == expected &&
+	       expected.size() <= size_t(MAX_CAPTURE_SETS);
+}
+
+// Whether `board` holds four in a row.
+bool has_row(ullint board) {
+	for (auto axis : axes) {
+		if (four_in_a_row_ends(board, axis))
+			return true;
+	}
+	return false;
+}
+
+// Whether `boards` could be a position: no rows and at most 15 pieces a
+// side, none on the edge.
+bool valid_position(const ullint (&boards)[2]) {
+	for (auto board : boards) {
+		if (__builtin_popcountll(board) > 15 || has_row(board) ||
+		    !in_board(board))
+			return false;
+	}
+	return true;
+}
+
+// Positions where one push forms 6, 7 and 8 capture sets.
+const ullint rich_positions[][2] = {
+    {16188395738955776ULL, 18067795159311168ULL},
+    {18014950011728768ULL, 16257875007504384ULL},
+    {16046831180460928ULL, 18190809202524160ULL}};
+const int n_rich = sizeof(rich_positions) / sizeof(rich_positions[0]);
+
+int main(int argc, char *argv[]) {
+	const int boards = (argc > 1) ? atoi(argv[1]) : 100000;
+	const vector<vector<int>> lines[3] = {board_lines(axes[0]),
+	                                      board_lines(axes[1]),
+	                                      board_lines(axes[2])};
+	mt19937_64 rng(1);
+	int checked = 0, with_rows = 0, failures = 0, most_sets = 0;
+	// Checks the board after every push by the owner of `own` and returns
+	// the most capture sets one of them forms.
+	auto check_pushes = [&](ullint own, ullint other) {
+		int most = 0;
+		for (const Push &push : entry_pushes) {
+			Board after, after_combined;
+			after.board = own;
+			after_combined.board = own | other;
+			if (!after_combined.CanMove(push.elt, push.dir))
+				continue;
+			after.SlidePieces(push.elt, push.dir, after_combined);
+			const ullint pushed_other = after_combined.board & ~after.board;
+			with_rows += has_row(after.board) || has_row(pushed_other);
+			int sets = 0;
+			if (!check_board(after.board, pushed_other, lines, sets)) {
+				if (failures++ < 10)
+					cout << "mismatch: own " << after.board << " other "
+					     << pushed_other << endl;
+			}
+			most = max(most, sets);
+			most_sets = max(most_sets, sets);
+			checked++;
+		}
+		return most;
+	};
+
+	while (checked < boards / 2) {
+		GipfState state;
+		for (int ply = 0; ply < 200 && !state.is_terminal(); ply++) {
+			const bool first = state.player_to_move == PLAYER_1;
+			check_pushes(first ? state.board_1.board : state.board_2.board,
+			             first ? state.board_2.board : state.board_1.board);
+			GipfMoveList moves;
+			state.generate_moves(moves);
+			state.make_move(moves[rng() % moves.size()]);
+		}
+	}
+
+	while (checked < boards) {
+		// Start from random pieces on about half the cells, or from one of
+		// the richest positions a longer search of this kind found.
+		ullint position[2] = {0, 0};
+		const int seed = rng() % (n_rich + 1);
+		if (seed < n_rich) {
+			position[0] = rich_positions[seed][0];
+			position[1] = rich_positions[seed][1];
+		}
+		for (int bit = 0; seed == n_rich && bit < 61; bit++) {
+			const int side = rng() % 2;
+			ullint next[2] = {position[0], position[1]};
+			next[side] |= 1ULL << bit;
+			if (rng() % 2 && valid_position(next))
+				position[side] = next[side];
+		}
+		int best = 0;
+		for (int step = 0; step < 300 && checked < boards; step++) {
+			ullint next[2] = {position[0], position[1]};
+			const ullint cell = 1ULL << (rng() % 61);
+			next[0] &= ~cell;
+			next[1] &= ~cell;
+			if (rng() % 3)
+				next[rng() % 2] |= cell;
+			if (!valid_position(next))
+				continue;
+			const int sets = max(check_pushes(next[0], next[1]),
+			                     check_pushes(next[1], next[0]));
+			if (sets >= best) {
+				best = sets;
+				position[0] = next[0];
+				position[1] = next[1];
+			}
+		}
+	}
+
+	cout << checked << " boards, " << with_rows << " with rows, " << failures
+	     << " mismatches, at most " << most_sets << " capture sets" << endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
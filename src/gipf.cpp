@@ -0,0 +1,109 @@
+#include "board.h"
+
+#include <cstdlib>
+#include <stdexcept>
+
+/**
+  The out-of-line parts of the engine: parsing and printing positions.
+  Only gtsa-free headers may be included here; see board.h.
+*/
+
+namespace {
+
+const std::array<const char *, 23> board_string = {
+    " +-------------------------------------+ ",
+    " | A5  B6  C7  D8  E9  F8  G7  H6  I5  | ",
+    " |                                     | ",
+    " |                  x                  | ",
+    " |              x       x              | ",
+    " |          x       *       x          | ",
+    " |      x       *       *       x      | ",
+    " |  x       *       *       *       x  | ",
+    " |      *       *       *       *      | ",
+    " |  x       *       *       *       x  | ",
+    " |      *       *       *       *      | ",
+    " |  x       *       *       *       x  | ",
+    " |      *       *       *       *      | ",
+    " |  x       *       *       *       x  | ",
+    " |      *       *       *       *      | ",
+    " |  x       *       *       *       x  | ",
+    " |      x       *       *       x      | ",
+    " |          x       *       x          | ",
+    " |              x       x              | ",
+    " |                  x                  | ",
+    " |                                     | ",
+    " | A1  B1  C1  D1  E1  F1  G1  H1  I1  | ",
+    " +-------------------------------------+ "};
+
+} // namespace
+
+void read_position(const std::string &init_string, Board &board_1,
+                   Board &board_2, int &pieces_left_1, int &pieces_left_2) {
+	const unsigned long length = init_string.length();
+	const unsigned long correct_length = 61;
+	if (length != correct_length) {
+		throw std::invalid_argument("Initialization string length must be " +
+		                            std::to_string(correct_length));
+	}
+	for (auto c : init_string) {
+		if (c != PLAYER_1 && c != PLAYER_2 && c != EMPTY) {
+			throw std::invalid_argument(
+			    std::string("Undefined symbol used: '") + c + "'");
+		}
+	}
+
+	for (int x = 0; x < 9; ++x) {
+		for (int y = 0; y < COLLEN[x]; ++y) {
+			const char c = init_string[COLSUMS[x] + y];
+			if (c != EMPTY && !in_board(xytoint(x, y))) {
+				throw std::invalid_argument("Pieces cannot be placed on the "
+				                            "edge of the board");
+			}
+			if (c == PLAYER_1) {
+				board_1.set(x, y, 1);
+				pieces_left_1--;
+			} else if (c == PLAYER_2) {
+				board_2.set(x, y, 1);
+				pieces_left_2--;
+			}
+		}
+	}
+	if (pieces_left_1 < 0 || pieces_left_2 < 0) {
+		throw std::invalid_argument("Each player has at most 15 pieces");
+	}
+	// Every move captures the rows it forms, and MAX_CAPTURE_SETS relies on
+	// it.
+	for (const Board &board : {board_1, board_2}) {
+		for (auto axis : axes) {
+			if (four_in_a_row_ends(board.board, axis)) {
+				throw std::invalid_argument("Four in a row must be captured "
+				                            "before the position is set up");
+			}
+		}
+	}
+}
+
+std::ostream &write_position(std::ostream &os, const Board &board_1,
+                             const Board &board_2, int pieces_left_1,
+                             int pieces_left_2) {
+	std::vector<std::string> board_string_copy(board_string.begin(),
+	                                           board_string.end());
+	for (int i = 0; i < 9; i++) {
+		for (int j = 0; j < 9 - abs(i - 4); j++) {
+			int i_eff = 19 - abs(i - 4) - (j * 2);
+			int j_eff = i * 4 + 4;
+			if (board_1.get(i, j)) {
+				board_string_copy[i_eff][j_eff] = 'W';
+			} else if (board_2.get(i, j)) {
+				board_string_copy[i_eff][j_eff] = 'B';
+			}
+		}
+	}
+	os << " +-------------------------------------+ \n";
+	os << "         Pieces Left: B(" << pieces_left_2 << ") W("
+	   << pieces_left_1 << ")\n";
+	for (auto row : board_string_copy) {
+		os << row << std::endl;
+	}
+	return os;
+}
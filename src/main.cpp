@@ -1,10 +1,56 @@
+#include "alpha_beta.h"
 #include "gipf.h"
+#include "parallel_mcts.h"
+#include "search_stats.h"
+
+// Usage: simulator [--alpha-beta] [STATS_FILE]. By default two MCTS players
+// meet; --alpha-beta makes the first one the alpha-beta engine. With a
+// build with GIPF_INSTRUMENT, the statistics of every search are appended
+// to STATS_FILE as JSON lines.
+int main(int argc, char *argv[]) {
+	bool use_alpha_beta = false;
+	const char *stats_file = nullptr;
+	for (int i = 1; i < argc; i++) {
+		const string arg = argv[i];
+		if (arg == "--alpha-beta") {
+			use_alpha_beta = true;
+		} else if (arg.compare(0, 2, "--") != 0 && !stats_file) {
+			stats_file = argv[i];
+		} else {
+			cerr << "Usage: simulator [--alpha-beta] [STATS_FILE]" << endl;
+			return EXIT_FAILURE;
+		}
+	}
 
-int main() {
 	GipfState state = GipfState();
 
-	MonteCarloTreeSearch<GipfState, GipfMove> a(0.2, 38);
-	MonteCarloTreeSearch<GipfState, GipfMove> b(0.1, 55);
+	// max seconds per move, or max seconds and max simulations with one
+	// search thread per core
+	std::unique_ptr<AlphaBeta> alpha_beta;
+	std::unique_ptr<ParallelMCTS> mcts;
+	if (use_alpha_beta)
+		alpha_beta.reset(new AlphaBeta(0.2));
+	else
+		mcts.reset(new ParallelMCTS(0.2, 38));
+	Algorithm<GipfState, GipfMove> &a =
+	    alpha_beta ? static_cast<Algorithm<GipfState, GipfMove> &>(*alpha_beta)
+	               : *mcts;
+	ParallelMCTS b(0.1, 55);
+
+	std::unique_ptr<SearchStatsLog> stats_log;
+	if (stats_file) {
+		try {
+			stats_log.reset(new SearchStatsLog(stats_file));
+		} catch (const runtime_error &error) {
+			cerr << error.what() << endl;
+			return EXIT_FAILURE;
+		}
+		if (alpha_beta)
+			alpha_beta->set_stats_log(stats_log.get());
+		else
+			mcts->set_stats_log(stats_log.get());
+		b.set_stats_log(stats_log.get());
+	}
 
 	// state, player a, player b, no of games, verbose, generate gif
 	Tester<GipfState, GipfMove> tester(&state, a, b, 3, false, true);
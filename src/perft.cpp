@@ -0,0 +1,95 @@
+#include "gipf.h"
+
+#include <chrono>
+#include <cstdlib>
+
+/**
+  Counts the leaf nodes of the game tree to a fixed depth and checks them
+  against known totals, so changes to CanMove, SlidePieces and
+  GetCaptureMaskSets can be measured and checked for regressions.
+
+  Usage:
+    perft                        check every reference position
+    perft <depth> [init_string]  count a single position
+*/
+
+struct PerftCase {
+	const char *name;
+	const char *init_string;
+	int depth;
+	unsigned long long nodes;
+};
+
+// Positions are in GipfState init_string order with player 1 to move.
+const PerftCase reference_cases[] = {
+    {"initial", nullptr, 4, 3111696},
+    {"midgame-1",
+     "______2221__2_111__222112__12____2__11___2______2__111_______", 4,
+     1394743},
+    {"midgame-2",
+     "_______22___22211__1___12__12____2__2_1112__12111__12_2______", 4,
+     886112},
+    {"midgame-3",
+     "______2121__2_2_1__122______1__122__12_221__11__1__12________", 4,
+     2094532},
+    {"midgame-4",
+     "______1211__22_22__1__2____1___2_2__1_1211___2_12__21_1______", 4,
+     1907660},
+};
+
+// `lists` holds a move list per remaining depth, reused across nodes.
+unsigned long long perft(GipfState &state, int depth,
+                         vector<GipfMoveList> &lists) {
+	if (depth == 0)
+		return 1;
+	if (state.is_terminal())
+		return 0;
+
+	GipfMoveList &moves = lists[depth];
+	moves.clear();
+	state.generate_moves(moves);
+	if (depth == 1)
+		return moves.size();
+
+	unsigned long long nodes = 0;
+	for (const auto &move : moves) {
+		state.make_move(move);
+		nodes += perft(state, depth - 1, lists);
+		state.undo_move(move);
+	}
+	return nodes;
+}
+
+unsigned long long timed_perft(const string &name, GipfState state,
+                               int depth) {
+	auto start = chrono::steady_clock::now();
+	vector<GipfMoveList> lists(depth + 1);
+	auto nodes = perft(state, depth, lists);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	cout << name << " depth " << depth << ": " << nodes << " nodes in "
+	     << elapsed.count() << "s (" << (nodes / max(elapsed.count(), 1e-9))
+	     << " nodes/s)" << endl;
+	return nodes;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1) {
+		int depth = atoi(argv[1]);
+		GipfState state = (argc > 2) ? GipfState(argv[2]) : GipfState();
+		timed_perft("position", state, depth);
+		return 0;
+	}
+
+	int failures = 0;
+	for (const auto &test : reference_cases) {
+		GipfState state = test.init_string ? GipfState(test.init_string)
+		                                   : GipfState();
+		auto nodes = timed_perft(test.name, state, test.depth);
+		if (nodes != test.nodes) {
+			cout << "  expected " << test.nodes << endl;
+			failures++;
+		}
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#include "gipf.h"
+#include "playout.h"
+
+#include <cstdlib>
+
+/**
+  Checks random_playout against the same playout played with
+  generate_moves and make_move. Both draw the push from the same random
+  numbers, and the reference plays the first move generate_moves lists
+  for it, so the winner and the number of plies must agree.
+
+  Usage:
+    playout_test [playouts]
+*/
+
+template <class RNG>
+PlayoutResult reference_playout(GipfState state, RNG &rng,
+                                int max_plies = 1000) {
+	int plies = 0;
+	while (!state.is_terminal() && plies < max_plies) {
+		if (state.count_legal_pushes() == 0)
+			break;
+		uint64_t pick = state.legal_pushes;
+		for (int k = rng() % state.count_legal_pushes(); k > 0; k--)
+			pick &= pick - 1;
+		const Push &push = entry_pushes[__builtin_ctzll(pick)];
+
+		GipfMoveList moves;
+		state.generate_moves(moves);
+		const GipfMove *move = moves.begin();
+		while (move->elt != push.elt || move->dir != push.dir)
+			move++;
+		state.apply_move(*move);
+		plies++;
+	}
+
+	char winner = EMPTY;
+	if (state.is_winner(PLAYER_1)) {
+		winner = PLAYER_1;
+	} else if (state.is_winner(PLAYER_2)) {
+		winner = PLAYER_2;
+	}
+	return PlayoutResult{winner, plies};
+}
+
+int main(int argc, char *argv[]) {
+	const int playouts = (argc > 1) ? atoi(argv[1]) : 3000;
+	mt19937_64 rng(1);
+	int failures = 0, decided = 0;
+	for (int i = 0; i < playouts; i++) {
+		// Start from the initial position or a random later one.
+		GipfState state;
+		const int plies = rng() % 60;
+		for (int ply = 0; ply < plies && !state.is_terminal(); ply++) {
+			GipfMoveList moves;
+			state.generate_moves(moves);
+			state.make_move(moves[rng() % moves.size()]);
+		}
+
+		const unsigned long long seed = rng();
+		mt19937_64 kernel_rng(seed), reference_rng(seed);
+		const PlayoutResult kernel = random_playout(state, kernel_rng);
+		const PlayoutResult reference =
+		    reference_playout(state, reference_rng);
+		decided += kernel.winner != EMPTY;
+		if (kernel.winner != reference.winner ||
+		    kernel.plies != reference.plies) {
+			if (failures++ < 10)
+				cout << "playout " << i << ": winner " << kernel.winner
+				     << " after " << kernel.plies << " plies, expected "
+				     << reference.winner << " after " << reference.plies
+				     << endl;
+		}
+	}
+
+	cout << playouts << " playouts, " << decided << " decided, " << failures
+	     << " mismatches" << endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+#include "batch_eval.h"
+#include "game_record.h"
+#include "gipf.h"
+#include "parallel_mcts.h"
+#include "puct_mcts.h"
+#include "search_stats.h"
+#include "transposition_table.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+/**
+  Plays many independent games at once on a pool of threads and streams
+  each finished game to disk as it completes.
+
+  With `--format binary` games are appended as game_record.h records, with
+  search statistics for moves chosen by MCTS. With `--format text` each game
+  is one line:
+
+    <game> <seed> <winner> <plies> <move> <move> ...
+
+  where winner is 1, 2 or _ for a draw and each move is
+  <entry bit>:<direction>[/<captured row mask>...] in hex.
+
+  Usage:
+    selfplay [--games N] [--threads N] [--seed N] [--max-plies N]
+             [--player1 SPEC] [--player2 SPEC] [--out FILE]
+             [--format text|binary] [--batch-size N]
+             [--batch-timeout-ms T] [--eval-latency-us T] [--tt-mb N]
+             [--tree-mb N] [--stats FILE]
+
+  A player SPEC is `random`, `mcts[:simulations[:seconds]]` or
+  `puct[:simulations[:seconds]]`. PUCT players score leaves with random
+  rollouts. With `--batch-size N` they instead share one queue that batches
+  leaves from all running games for a stub evaluator. Each batch costs
+  `--eval-latency-us`, which models network inference. `--tt-mb N` gives
+  all PUCT players one shared N MB transposition table for leaf values.
+  `--tree-mb N` caps the search tree of each PUCT player at N MB (default
+  64); beyond that its least-visited subtrees are pruned. `--stats FILE`
+  appends the statistics of every search to FILE as JSON lines; it needs
+  a build with GIPF_INSTRUMENT.
+*/
+
+struct RandomPlayer : public Algorithm<GipfState, GipfMove> {
+	std::mt19937_64 rng;
+
+	RandomPlayer(unsigned long long seed) : rng(seed) {}
+
+	GipfMove get_move(GipfState *state) override {
+		GipfMoveList moves;
+		state->generate_moves(moves);
+		return moves[rng() % moves.size()];
+	}
+
+	string get_name() const override { return "Random"; }
+};
+
+struct PlayerSpec {
+	string kind = "mcts";
+	int simulations = 200;
+	double seconds = 1;
+
+	static PlayerSpec parse(const string &text) {
+		PlayerSpec spec;
+		std::istringstream stream(text);
+		string field;
+		getline(stream, spec.kind, ':');
+		if (getline(stream, field, ':'))
+			spec.simulations = atoi(field.c_str());
+		if (getline(stream, field, ':'))
+			spec.seconds = atof(field.c_str());
+		if (spec.kind != "random" && spec.kind != "mcts" && spec.kind != "puct")
+			throw invalid_argument("Unknown player: " + text);
+		return spec;
+	}
+
+	// Each game runs on one pool thread, so searches are single-threaded.
+	// PUCT players use `evaluator` and `table` if they are not null, and
+	// keep their trees within `tree_megabytes`. Searching players log
+	// to `stats_log` if it is not null.
+	std::unique_ptr<Algorithm<GipfState, GipfMove>>
+	create(unsigned long long seed, PUCTEvaluator *evaluator,
+	       TranspositionTable *table, int tree_megabytes,
+	       SearchStatsLog *stats_log) const {
+		if (kind == "random")
+			return std::unique_ptr<RandomPlayer>(new RandomPlayer(seed));
+		if (kind == "puct") {
+			std::unique_ptr<PUCTMCTS> player(
+			    new PUCTMCTS(5, seconds, simulations, evaluator, seed,
+			                 tree_megabytes));
+			player->set_table(table);
+			player->set_stats_log(stats_log);
+			return player;
+		}
+		std::unique_ptr<ParallelMCTS> player(
+		    new ParallelMCTS(seconds, simulations, 1, std::sqrt(2.0), 1,
+		                     1000, seed));
+		player->set_stats_log(stats_log);
+		return player;
+	}
+};
+
+struct SelfPlayConfig {
+	int games = 1000;
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	unsigned long long seed = 1;
+	int max_plies = 1000;
+	PlayerSpec players[2];
+	string out = "selfplay.txt";
+	bool binary = false;
+	int batch_size = 0;
+	double batch_timeout_ms = 2;
+	int eval_latency_us = 0;
+	int tt_megabytes = 0;
+	int tree_megabytes = 64;
+	string stats;
+};
+
+// Search statistics of the last move chosen by `player`, if it searches.
+const ParallelMCTSStats *
+search_stats(const Algorithm<GipfState, GipfMove> &player) {
+	if (const auto *mcts = dynamic_cast<const ParallelMCTS *>(&player))
+		return &mcts->last_search;
+	if (const auto *puct = dynamic_cast<const PUCTMCTS *>(&player))
+		return &puct->last_search;
+	return nullptr;
+}
+
+struct GameResult {
+	char winner = EMPTY;
+	vector<GipfMove> moves;
+	GameRecordBuilder record;
+};
+
+GameResult play_game(const SelfPlayConfig &config, int game,
+                     unsigned long long seed, PUCTEvaluator *evaluator,
+                     TranspositionTable *table, SearchStatsLog *stats_log) {
+	GameResult result;
+	result.record = GameRecordBuilder(game, seed);
+	GipfState state;
+	auto player_1 = config.players[0].create(
+	    seed * 2, evaluator, table, config.tree_megabytes, stats_log);
+	auto player_2 = config.players[1].create(
+	    seed * 2 + 1, evaluator, table, config.tree_megabytes, stats_log);
+
+	for (int ply = 0; ply < config.max_plies && !state.is_terminal(); ply++) {
+		GipfMoveList legal;
+		state.generate_moves(legal);
+		if (legal.empty())
+			break;
+		auto &player =
+		    (state.player_to_move == PLAYER_1) ? player_1 : player_2;
+		GipfMove move = player->get_move(&state);
+		result.moves.push_back(move);
+		if (config.binary) {
+			MoveStats stats{0, 0};
+			if (const auto *search = search_stats(*player)) {
+				stats.simulations = search->simulations;
+				stats.value = search->value;
+			}
+			result.record.add(state, move, stats);
+		}
+		state.apply_move(move);
+	}
+	if (state.is_winner(PLAYER_1)) {
+		result.winner = PLAYER_1;
+	} else if (state.is_winner(PLAYER_2)) {
+		result.winner = PLAYER_2;
+	}
+	result.record.finish(result.winner);
+	return result;
+}
+
+string format_game(int game, unsigned long long seed,
+                   const GameResult &result) {
+	std::ostringstream line;
+	line << game << ' ' << seed << ' ' << result.winner << ' '
+	     << result.moves.size() << std::hex;
+	for (const auto &move : result.moves) {
+		line << ' ' << move.elt << ':' << direction_name(move.dir);
+		for (auto row : move.captures)
+			line << '/' << row;
+	}
+	line << '\n';
+	return line.str();
+}
+
+int main(int argc, char *argv[]) {
+	SelfPlayConfig config;
+	try {
+		for (int i = 1; i < argc; i += 2) {
+			if (i + 1 == argc)
+				throw invalid_argument(string("Missing value for ") + argv[i]);
+			if (!strcmp(argv[i], "--games")) {
+				config.games = atoi(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--threads")) {
+				config.threads = max(1, atoi(argv[i + 1]));
+			} else if (!strcmp(argv[i], "--seed")) {
+				config.seed = strtoull(argv[i + 1], nullptr, 10);
+			} else if (!strcmp(argv[i], "--max-plies")) {
+				config.max_plies = atoi(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--player1")) {
+				config.players[0] = PlayerSpec::parse(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--player2")) {
+				config.players[1] = PlayerSpec::parse(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--out")) {
+				config.out = argv[i + 1];
+			} else if (!strcmp(argv[i], "--format")) {
+				config.binary = !strcmp(argv[i + 1], "binary");
+				if (!config.binary && strcmp(argv[i + 1], "text"))
+					throw invalid_argument("Unknown format " +
+					                       string(argv[i + 1]));
+			} else if (!strcmp(argv[i], "--batch-size")) {
+				config.batch_size = atoi(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--batch-timeout-ms")) {
+				config.batch_timeout_ms = atof(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--eval-latency-us")) {
+				config.eval_latency_us = atoi(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--tt-mb")) {
+				config.tt_megabytes = atoi(argv[i + 1]);
+			} else if (!strcmp(argv[i], "--tree-mb")) {
+				config.tree_megabytes = max(1, atoi(argv[i + 1]));
+			} else if (!strcmp(argv[i], "--stats")) {
+				config.stats = argv[i + 1];
+			} else {
+				throw invalid_argument(string("Unknown option ") + argv[i]);
+			}
+		}
+	} catch (const invalid_argument &error) {
+		cerr << error.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream out;
+	std::unique_ptr<GameRecordWriter> writer;
+	std::unique_ptr<SearchStatsLog> stats_log;
+	try {
+		if (config.binary) {
+			writer.reset(new GameRecordWriter(config.out));
+		} else {
+			out.open(config.out);
+			if (!out)
+				throw runtime_error("Cannot open " + config.out);
+		}
+		if (!config.stats.empty())
+			stats_log.reset(new SearchStatsLog(config.stats));
+	} catch (const runtime_error &error) {
+		cerr << error.what() << endl;
+		return EXIT_FAILURE;
+	}
+
+	StubBatchEvaluator stub(200, config.eval_latency_us);
+	std::unique_ptr<EvalQueue> queue;
+	std::unique_ptr<QueuedEvaluator> queued;
+	if (config.batch_size > 0) {
+		queue.reset(
+		    new EvalQueue(stub, config.batch_size, config.batch_timeout_ms));
+		queued.reset(new QueuedEvaluator(*queue));
+	}
+	std::unique_ptr<TranspositionTable> table;
+	if (config.tt_megabytes > 0)
+		table.reset(new TranspositionTable(config.tt_megabytes));
+
+	std::mutex out_mutex;
+	std::atomic<int> next_game{0};
+	std::atomic<long long> total_moves{0};
+	int wins[2] = {0, 0};
+	const auto start = std::chrono::steady_clock::now();
+
+	auto worker = [&]() {
+		int game;
+		while ((game = next_game.fetch_add(1)) < config.games) {
+			const unsigned long long seed = config.seed + game;
+			GameResult result =
+			    play_game(config, game, seed, queued.get(), table.get(),
+			              stats_log.get());
+			total_moves += result.moves.size();
+			if (writer)
+				writer->write(result.record);
+
+			std::lock_guard<std::mutex> lock(out_mutex);
+			if (!writer)
+				out << format_game(game, seed, result);
+			if (result.winner != EMPTY)
+				wins[result.winner == PLAYER_1 ? 0 : 1]++;
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int i = 0; i < config.threads; i++) {
+		pool.emplace_back(worker);
+	}
+	for (auto &thread : pool) {
+		thread.join();
+	}
+
+	const double seconds =
+	    std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+	        .count();
+	cout << config.games << " games, " << total_moves << " moves in "
+	     << seconds << "s on " << config.threads << " threads: "
+	     << config.games / seconds << " games/s, "
+	     << total_moves / seconds << " moves/s" << endl;
+	cout << "player 1 won " << wins[0] << ", player 2 won " << wins[1]
+	     << ", drawn " << config.games - wins[0] - wins[1] << endl;
+	if (queue) {
+		const EvalQueueStats stats = queue->stats();
+		cout << stats.leaves << " leaves in " << stats.batches
+		     << " batches: " << stats.leaves / seconds << " leaves/s, "
+		     << stats.average_batch() << " per batch, " << stats.timeouts
+		     << " timed out" << endl;
+	}
+	if (table) {
+		const TTStats stats = table->stats();
+		cout << "transposition table: " << stats.probes << " probes, "
+		     << 100 * stats.hit_rate() << "% hits" << endl;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#include "alpha_beta.h"
+#include "gipf.h"
+
+#include <cstdlib>
+#include <cstring>
+
+/**
+  Measures how the parallel alpha-beta search scales. Every position is
+  searched to a fixed depth with a fresh transposition table, at 1, 2, 4,
+  ... up to --max-threads threads. For each thread count the report gives:
+
+    speedup   time to depth at 1 thread / time to depth at N threads
+    overhead  nodes searched at N threads / nodes at 1 thread - 1
+
+  Results are written to stdout as JSON.
+
+  Usage:
+    smp_bench [--depth N] [--max-threads N] [--table-mb N]
+*/
+
+// The perft reference midgames, plus the initial position.
+const char *const positions[] = {
+    nullptr,
+    "______2221__2_111__222112__12____2__11___2______2__111_______",
+    "_______22___22211__1___12__12____2__2_1112__12111__12_2______",
+    "______2121__2_2_1__122______1__122__12_221__11__1__12________",
+    "______1211__22_22__1__2____1___2_2__1_1211___2_12__21_1______",
+};
+
+struct SMPBenchConfig {
+	int depth = 7;
+	int max_threads = 32;
+	size_t table_megabytes = 64;
+};
+
+struct SMPResult {
+	int threads;
+	double seconds = 0;
+	long long nodes = 0;
+};
+
+SMPResult run(const SMPBenchConfig &config, int threads) {
+	SMPResult result;
+	result.threads = threads;
+	for (const char *init_string : positions) {
+		GipfState state = init_string ? GipfState(init_string) : GipfState();
+		AlphaBeta search(1e9, config.depth, config.table_megabytes, threads);
+		search.get_move(&state);
+		result.seconds += search.last_search.seconds;
+		result.nodes +=
+		    search.last_search.nodes + search.last_search.quiescence_nodes;
+	}
+	return result;
+}
+
+int main(int argc, char *argv[]) {
+	SMPBenchConfig config;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--depth")) {
+			config.depth = atoi(argv[i + 1]);
+		} else if (!strcmp(argv[i], "--max-threads")) {
+			config.max_threads = atoi(argv[i + 1]);
+		} else if (!strcmp(argv[i], "--table-mb")) {
+			config.table_megabytes = atoi(argv[i + 1]);
+		} else {
+			cerr << "Unknown option " << argv[i] << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	vector<SMPResult> results;
+	for (int threads = 1; threads <= config.max_threads; threads *= 2)
+		results.push_back(run(config, threads));
+
+	const SMPResult &base = results.front();
+	cout << "{\n  \"depth\": " << config.depth
+	     << ",\n  \"positions\": " << sizeof(positions) / sizeof(positions[0])
+	     << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+	     << ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const SMPResult &result = results[i];
+		cout << "    {\"threads\": " << result.threads
+		     << ", \"seconds\": " << result.seconds
+		     << ", \"nodes\": " << result.nodes
+		     << ", \"nodes_per_second\": " << result.nodes / result.seconds
+		     << ", \"speedup\": " << base.seconds / result.seconds
+		     << ", \"overhead\": "
+		     << double(result.nodes) / base.nodes - 1 << "}"
+		     << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	cout << "  ]\n}" << endl;
+	return EXIT_SUCCESS;
+}
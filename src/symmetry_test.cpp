@@ -0,0 +1,98 @@
+#include "gipf.h"
+#include "symmetry.h"
+
+#include <cstdlib>
+
+/**
+  Checks the board symmetries on positions from seeded random games. For
+  every position and transform:
+   - the moves generated in the image are the images of the moves,
+   - playing the image of a move in the image gives the image of the
+     position after the move,
+   - the inverse transform maps the image back, and
+   - all 12 images share one canonical position and key.
+
+  Usage:
+    symmetry_test [positions]
+*/
+
+// Moves of `state` ordered by hash, for comparison as a set.
+vector<GipfMove> sorted_moves(const GipfState &state) {
+	vector<GipfMove> moves = state.get_legal_moves();
+	sort(moves.begin(), moves.end(), [](const GipfMove &a, const GipfMove &b) {
+		return a.hash() < b.hash();
+	});
+	return moves;
+}
+
+bool same_position(const GipfState &a, const GipfState &b) {
+	return a == b && a.pieces_left_1 == b.pieces_left_1 &&
+	       a.pieces_left_2 == b.pieces_left_2 && a.key == b.key;
+}
+
+// Returns the number of failed checks for `state`.
+int check_position(const GipfState &state, mt19937_64 &rng) {
+	int failures = 0;
+	auto fail = [&](const char *check, int t) {
+		if (failures++ < 3)
+			cout << check << " failed for transform " << t << endl;
+	};
+
+	const vector<GipfMove> moves = sorted_moves(state);
+	const GipfMove &played = moves[rng() % moves.size()];
+	GipfState after = state.clone();
+	after.make_move(played);
+	const Canonical canonical = canonicalize(state);
+
+	for (int t = 0; t < SYMMETRIES; t++) {
+		const GipfState image = transform_state(t, state);
+
+		vector<GipfMove> mapped;
+		for (const auto &move : moves)
+			mapped.push_back(transform_move(t, move));
+		sort(mapped.begin(), mapped.end(),
+		     [](const GipfMove &a, const GipfMove &b) {
+			     return a.hash() < b.hash();
+		     });
+		if (mapped != sorted_moves(image))
+			fail("moves", t);
+
+		GipfState image_after = image.clone();
+		image_after.make_move(transform_move(t, played));
+		if (!same_position(image_after, transform_state(t, after)))
+			fail("make_move", t);
+
+		if (!same_position(transform_state(inverse_transform(t), image),
+		                   state))
+			fail("inverse", t);
+
+		const Canonical image_canonical = canonicalize(image);
+		if (image_canonical.key != canonical.key ||
+		    image_canonical.board_1 != canonical.board_1 ||
+		    image_canonical.board_2 != canonical.board_2)
+			fail("canonicalize", t);
+	}
+	return failures;
+}
+
+int main(int argc, char *argv[]) {
+	const int positions = (argc > 1) ? atoi(argv[1]) : 2000;
+	mt19937_64 rng(1);
+	int checked = 0, failures = 0;
+	while (checked < positions) {
+		GipfState state;
+		for (int ply = 0; ply < 100 && checked < positions; ply++) {
+			GipfMoveList moves;
+			state.generate_moves(moves);
+			if (state.is_terminal() || moves.empty())
+				break;
+			failures += check_position(state, rng);
+			checked++;
+			state.make_move(moves[rng() % moves.size()]);
+		}
+	}
+
+	cout << checked << " positions, " << SYMMETRIES << " transforms each, "
+	     << failures << " failures" << endl;
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}